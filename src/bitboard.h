@@ -0,0 +1,104 @@
+/**
+ * move generation with the bitboard backend, included by side.h once per
+ * side. a few shifts of the square sets find the pieces that can move or
+ * capture; only those are then looked at square by square on cboard, so
+ * the moves come out in the same order as with the mailbox backend.
+ */
+
+#if SIDE == BLACK
+#define FORE(b) STEP4(b)        /* one AHEAD step from the squares in b */
+#define FORE2(b) STEP5(b)       /* one AHEAD2 step */
+#define BACK(b) STEPM4(b)       /* the squares one AHEAD step leads into b from */
+#define BACK2(b) STEPM5(b)
+#else
+#define FORE(b) STEPM4(b)
+#define FORE2(b) STEPM5(b)
+#define BACK(b) STEP4(b)
+#define BACK2(b) STEP5(b)
+#endif
+
+/**
+ * purpose:generates all moves. no captures. returns number of moves
+ */
+int SIDED(generatemovelist)(struct move2 movelist[MAXMOVES]) {
+    uint32_t empty = ~(pieces[BLACK] | pieces[WHITE]);
+    uint32_t movers;
+    int n = 0;
+    int i;
+
+    /* pieces with a free square ahead, kings with one behind */
+    movers = pieces[SIDE] & (BACK(empty) | BACK2(empty));
+    movers |= pieces[SIDE] & kings & (FORE(empty) | FORE2(empty));
+
+    for(i = 5; movers != 0; i++) {
+        if( (movers & squarebit[i]) == 0 ) {
+            continue;
+        }
+        movers ^= squarebit[i];
+        if( (cboard[i] & MAN) != 0 ) {
+            int after = PROMOTES(i) ? (SIDE | KING) : (SIDE | MAN);
+            if( (cboard[i + AHEAD] & FREE) != 0 ) {
+                ADDSTEP(i, i + AHEAD, SIDE | MAN, after);
+            }
+            if( (cboard[i + AHEAD2] & FREE) != 0 ) {
+                ADDSTEP(i, i + AHEAD2, SIDE | MAN, after);
+            }
+        } else { /* cboard[i] is a KING */
+            if( (cboard[i + 4] & FREE) != 0 ) {
+                ADDSTEP(i, i + 4, SIDE | KING, SIDE | KING);
+            }
+            if( (cboard[i + 5] & FREE) != 0 ) {
+                ADDSTEP(i, i + 5, SIDE | KING, SIDE | KING);
+            }
+            if( (cboard[i - 4] & FREE) != 0 ) {
+                ADDSTEP(i, i - 4, SIDE | KING, SIDE | KING);
+            }
+            if( (cboard[i - 5] & FREE) != 0 ) {
+                ADDSTEP(i, i - 5, SIDE | KING, SIDE | KING);
+            }
+        }
+    }
+    return(n);
+}
+
+/**
+ * purpose: the pieces of the side to move that can capture
+ */
+uint32_t SIDED(jumpers)(void) {
+    uint32_t empty = ~(pieces[BLACK] | pieces[WHITE]);
+    uint32_t enemy = pieces[ENEMY];
+    uint32_t jumpers;
+
+    jumpers = pieces[SIDE] & (BACK(BACK(empty) & enemy) | BACK2(BACK2(empty) & enemy));
+    jumpers |= pieces[SIDE] & kings & (FORE(FORE(empty) & enemy) | FORE2(FORE2(empty) & enemy));
+    return(jumpers);
+}
+
+/**
+ * generate all possible captures
+ */
+int SIDED(generatecapturelist)(struct move2 movelist[MAXMOVES]) {
+    uint32_t jumpers = SIDED(jumpers)();
+    int n = 0;
+    int i;
+
+    for(i = 5; jumpers != 0; i++) {
+        if( (jumpers & squarebit[i]) != 0 ) {
+            jumpers ^= squarebit[i];
+            capturesequences(&n, movelist, i);
+        }
+    }
+    return(n);
+}
+
+/**
+ * purpose: test if the side to move has a capture on cboard
+ */
+int SIDED(testcapture)(void) {
+    return(SIDED(jumpers)() != 0);
+}
+
+#undef FORE
+#undef FORE2
+#undef BACK
+#undef BACK2
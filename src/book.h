@@ -0,0 +1,109 @@
+/**
+ * opening book: moves for the first plies of a game, played without a
+ * search. included by simplech.c for the probe; tools/bookgen.c builds
+ * the book from game archives and self-play.
+ *
+ * a book file is
+ *
+ *   "BOK", version, number of entries,
+ *   the entries, each the hash of a position, hashboard() with the side
+ *   to move, the from and to squares of a move, SQ_INDEX numbers, and
+ *   its weight
+ *
+ * with numbers of 32 bits, the weight 16 bits, least significant byte
+ * first, 8 bytes an entry. the entries are sorted by hash and the moves
+ * of a position by weight, heaviest first, so a probe is a binary search
+ * and takes the heaviest move that is legal. two captures between the
+ * same squares are the same entry, the first one generated is played.
+ *
+ * the book is used where it is stored, see tables.h: on the calc it is
+ * the archived appvar BOOK_NAME, which holds up to about 8000 entries.
+ */
+
+#ifndef BOOK_H
+#define BOOK_H
+
+#include "tables.h"
+
+#define BOOK_VERSION 1
+#define BOOK_HEADER 8
+#define BOOK_ENTRY 8
+
+#ifdef HOST_BUILD
+#define BOOK_NAME "book.bok"
+#else
+#define BOOK_NAME "CHKBOOK"
+#endif
+
+/* the book loaded, shared by all searches */
+const uint8_t *bookdata;
+uint32_t booklength;
+uint32_t bookentries;
+
+uint32_t bookread32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/**
+ * maps the book name, BOOK_NAME for NULL, in place of the one loaded.
+ * returns the number of entries, 0 if there is no usable book
+ */
+uint32_t bookload(const char *name) {
+    const uint8_t *file;
+    uint32_t length;
+
+    if(bookdata != NULL) {
+        tableclose(bookdata, booklength);
+        bookdata = NULL;
+        bookentries = 0;
+    }
+    if((file = tableopen(name != NULL ? name : BOOK_NAME, &length)) == NULL) {
+        return(0);
+    }
+    if(length < BOOK_HEADER || memcmp(file, "BOK", 3) != 0 || file[3] != BOOK_VERSION ||
+       length != BOOK_HEADER + (uint32_t)BOOK_ENTRY * bookread32(file + 4)) {
+        tableclose(file, length);
+        return(0);
+    }
+    bookdata = file;
+    booklength = length;
+    bookentries = bookread32(file + 4);
+    return(bookentries);
+}
+
+/**
+ * looks up the position on cboard, with hash hashkey, and sets played to
+ * the heaviest of its book moves in movelist. returns 0 if the book has
+ * none
+ */
+int bookmove(struct move2 *movelist, int numberofmoves, struct move2 *played) {
+    const uint8_t *entry;
+    uint32_t low = 0, high = bookentries;
+    int i;
+
+    /* the first entry of the position */
+    while(low < high) {
+        uint32_t middle = low + (high - low) / 2;
+
+        if(bookread32(bookdata + BOOK_HEADER + BOOK_ENTRY * middle) < hashkey) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    for(entry = bookdata + BOOK_HEADER + BOOK_ENTRY * low;
+        low < bookentries && bookread32(entry) == hashkey; low++, entry += BOOK_ENTRY) {
+        int from = entry[4] + 5 + (entry[4] + 4) / 8;
+        int to = entry[5] + 5 + (entry[5] + 4) / 8;
+
+        for(i = 0; i < numberofmoves; i++) {
+            if(movelist[i].m[0] % 256 == from && movelist[i].m[1] % 256 == to) {
+                *played = movelist[i];
+                return(1);
+            }
+        }
+    }
+    return(0);
+}
+
+#endif
@@ -0,0 +1,517 @@
+/**
+ * endgame databases: win, loss or draw for every position of a few
+ * pieces, included by simplech.c for the probes and by the host
+ * generator in tools/egdbgen.c.
+ *
+ * a slice holds all positions of one material signature, black men,
+ * black kings, white men and white kings, with black to move. a
+ * position with white to move is looked up turned around: square i
+ * becomes 31 - i and the colors swap, which gives black to move in the
+ * slice with the signature swapped.
+ *
+ * squares are SQ_INDEX numbers. the index of a position is
+ *
+ *   ((blackmen * W + whitemen) * K + blackkings) * L + whitekings
+ *
+ * where each part is the rank of its square set among all sets of that
+ * many squares. black men stand on 0..27 and white men on 4..31, since
+ * men never stand on their promotion row. black kings are ranked among
+ * the squares the men left free and white kings among those all others
+ * left free, so only positions where men of both colors share a square
+ * waste an index.
+ *
+ * the values are packed five to a byte as base 3 digits, the first
+ * position in the lowest digit, and the packed bytes are cut into blocks
+ * of EGDB_BLOCK. each block is compressed on its own: bytes 243, 244 and
+ * 245 followed by a count n stand for n + 2 bytes of 0, 121 and 242,
+ * five draws, wins or losses, and every other byte stands for itself.
+ * a table file is
+ *
+ *   "WLD", version, black men, black kings, white men, white kings,
+ *   number of positions,
+ *   offset of each block and of the end in the compressed data,
+ *   the compressed data
+ *
+ * with numbers of 32 bits, least significant byte first. it is named
+ * E<bm><bk><wm><wk>.wld, E1021.wld for one black man against two white
+ * men and a king.
+ *
+ * the files are probed where they are stored, see tables.h. on the calc
+ * each is an archived appvar named after the file without .wld, and a
+ * file over the 64k an appvar can hold is left out. a probe only unpacks
+ * the block it needs, into a cache of the EGDB_CACHEBLOCKS blocks used
+ * last.
+ */
+
+#ifndef EGDB_H
+#define EGDB_H
+
+#include "tables.h"
+
+/* material signatures of 2 to EGDB_MAXPIECES pieces, with both colors on the board */
+#define EGDB_SLICES 155
+
+#define EGDB_VERSION 2
+#define EGDB_HEADER 12
+
+/* packed bytes of a block, five positions each */
+#define EGDB_BLOCK 1024
+#define EGDB_BLOCKPOSITIONS ((uint32_t)EGDB_BLOCK * 5)
+
+/* first of the three run codes */
+#define EGDB_RUN 243
+
+/**
+ * unpacked blocks kept, a power of two. the calc can't spare more than
+ * a few; the host can lower the number at run time with egdbcache()
+ */
+#ifndef EGDB_CACHEBLOCKS
+#ifdef HOST_BUILD
+#define EGDB_CACHEBLOCKS 4096
+#else
+#define EGDB_CACHEBLOCKS 4
+#endif
+#endif
+
+/* no cache slot, the end of a list */
+#define EGDB_NOSLOT 0xFFFF
+
+/* a position with black to move, one square set per kind of piece */
+struct egdbposition {
+    uint32_t blackmen;
+    uint32_t blackkings;
+    uint32_t whitemen;
+    uint32_t whitekings;
+};
+
+struct egdbslice {
+    uint8_t pieces[4];      /* black men, black kings, white men, white kings */
+    uint32_t size;          /* positions */
+    uint32_t blocks;
+    const uint8_t *offsets; /* the block offsets, as in the file */
+    const uint8_t *data;    /* the compressed blocks */
+};
+
+/* a cache slot, on the lru list and on the chain of its hash bucket */
+struct egdbblock {
+    struct egdbslice *slice;
+    uint32_t block;
+    uint16_t newer;
+    uint16_t older;
+    uint16_t next;
+    uint8_t values[EGDB_BLOCK];
+};
+
+/* binomial[n][k] ways to pick k of n squares */
+uint32_t binomial[33][EGDB_MAXPIECES + 1];
+
+struct egdbslice egdbslices[EGDB_SLICES];
+int egdbcount;
+int egdbpieces; /* most pieces of a slice that is loaded, 0 for none */
+THREADLOCAL struct egdbslice *egdblast;
+
+THREADLOCAL struct egdbblock egdbcacheslots[EGDB_CACHEBLOCKS];
+THREADLOCAL uint16_t egdbbuckets[EGDB_CACHEBLOCKS];
+THREADLOCAL uint16_t egdbnewest, egdboldest;
+THREADLOCAL uint16_t egdbslotsused;
+THREADLOCAL uint16_t egdbslotlimit = EGDB_CACHEBLOCKS;
+
+/* probes and the ones that had to unpack their block */
+THREADLOCAL uint32_t egdbprobes;
+THREADLOCAL uint32_t egdbmisses;
+
+/**
+ * fills the binomial table, needed before any index is computed
+ */
+void egdbinit(void) {
+    int n, k;
+
+    for(n = 0; n <= 32; n++) {
+        binomial[n][0] = 1;
+        for(k = 1; k <= EGDB_MAXPIECES; k++) {
+            binomial[n][k] = n == 0 ? 0 : binomial[n - 1][k - 1] + binomial[n - 1][k];
+        }
+    }
+}
+
+/**
+ * rank of the square set among all sets of as many squares, where the
+ * squares below first and those in skip are not counted
+ */
+uint32_t egdbrank(uint32_t set, uint32_t skip, int first) {
+    uint32_t rank = 0;
+    int square, k = 0;
+
+    for(square = first; set != 0; square++) {
+        uint32_t bit = (uint32_t)1 << square;
+
+        if(skip & bit) {
+            first++;
+        } else if(set & bit) {
+            set ^= bit;
+            k++;
+            rank += binomial[square - first][k];
+        }
+    }
+    return(rank);
+}
+
+/**
+ * number of squares in set
+ */
+int egdbsquares(uint32_t set) {
+    int n = 0;
+
+    for(; set != 0; set &= set - 1) {
+        n++;
+    }
+    return(n);
+}
+
+/**
+ * positions of a slice, holes included
+ */
+uint32_t egdbsize(const uint8_t pieces[4]) {
+    int men = pieces[0] + pieces[2];
+
+    return(binomial[28][pieces[0]] * binomial[28][pieces[2]] *
+           binomial[32 - men][pieces[1]] * binomial[32 - men - pieces[1]][pieces[3]]);
+}
+
+/**
+ * index of the position in the slice of its signature
+ */
+uint32_t egdbindex(const struct egdbposition *pos, const uint8_t pieces[4]) {
+    uint32_t men = pos->blackmen | pos->whitemen;
+    int free = 32 - pieces[0] - pieces[2];
+    uint32_t index;
+
+    index = egdbrank(pos->blackmen, 0, 0) * binomial[28][pieces[2]] + egdbrank(pos->whitemen, 0, 4);
+    index = index * binomial[free][pieces[1]] + egdbrank(pos->blackkings, men, 0);
+    index = index * binomial[free - pieces[1]][pieces[3]] + egdbrank(pos->whitekings, men | pos->blackkings, 0);
+    return(index);
+}
+
+/**
+ * square i becomes 31 - i, for the other side's point of view
+ */
+uint32_t egdbflip(uint32_t set) {
+    uint32_t flipped = 0;
+    int i;
+
+    for(i = 0; i < 32; i++) {
+        flipped = (flipped << 1) | (set & 1);
+        set >>= 1;
+    }
+    return(flipped);
+}
+
+/**
+ * turns the position around, the side to move becomes black
+ */
+void egdbmirror(struct egdbposition *pos) {
+    uint32_t men = pos->blackmen;
+    uint32_t kings = pos->blackkings;
+
+    pos->blackmen = egdbflip(pos->whitemen);
+    pos->blackkings = egdbflip(pos->whitekings);
+    pos->whitemen = egdbflip(men);
+    pos->whitekings = egdbflip(kings);
+}
+
+/**
+ * value of the index-th position of packed values, DRAW, WIN or LOSS for the side to move
+ */
+int egdbvalue(const uint8_t *data, uint32_t index) {
+    static const uint8_t power[5] = {1, 3, 9, 27, 81};
+
+    return((data[index / 5] / power[index % 5]) % 3);
+}
+
+/**
+ * 32 bit number at p, least significant byte first
+ */
+uint32_t egdbread32(const uint8_t *p) {
+    return(p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+/**
+ * packed bytes of a table of size positions
+ */
+uint32_t egdbbytes(uint32_t size) {
+    return((size + 4) / 5);
+}
+
+/**
+ * unpacks length bytes of a compressed block into at most room packed
+ * bytes. returns the number of packed bytes
+ */
+uint32_t egdbunpack(const uint8_t *in, uint32_t length, uint8_t *out, uint32_t room) {
+    static const uint8_t runs[3] = {0, 121, 242};
+    uint32_t n = 0;
+
+    while(length != 0 && n < room) {
+        uint8_t byte = *in++;
+
+        length--;
+        if(byte >= EGDB_RUN && length != 0) {
+            uint32_t count = *in++ + 2;
+
+            length--;
+            if(count > room - n) {
+                count = room - n;
+            }
+            memset(out + n, runs[byte - EGDB_RUN], count);
+            n += count;
+        } else {
+            out[n++] = byte;
+        }
+    }
+    return(n);
+}
+
+/**
+ * empties the block cache and keeps at most bytes of unpacked blocks in
+ * it from now on, at least one block and at most EGDB_CACHEBLOCKS
+ */
+void egdbcache(uint32_t bytes) {
+    uint32_t slots = bytes / EGDB_BLOCK;
+
+    egdbslotlimit = slots < 1 ? 1 : slots > EGDB_CACHEBLOCKS ? EGDB_CACHEBLOCKS : slots;
+    memset(egdbbuckets, 0xFF, sizeof(egdbbuckets));
+    egdbnewest = egdboldest = EGDB_NOSLOT;
+    egdbslotsused = 0;
+    egdbprobes = egdbmisses = 0;
+}
+
+/**
+ * the unpacked values of a block of a slice, from the cache or unpacked
+ * into the slot used longest ago
+ */
+const uint8_t *egdbblock(struct egdbslice *slice, uint32_t block) {
+    uint16_t *bucket = &egdbbuckets[((uint32_t)(slice - egdbslices) * 40503u + block) & (EGDB_CACHEBLOCKS - 1)];
+    struct egdbblock *slot;
+    uint16_t i;
+    uint32_t start, end;
+
+    for(i = *bucket; i != EGDB_NOSLOT; i = egdbcacheslots[i].next) {
+        if(egdbcacheslots[i].slice == slice && egdbcacheslots[i].block == block) {
+            break;
+        }
+    }
+
+    if(i == EGDB_NOSLOT) {
+        egdbmisses++;
+        if(egdbslotsused < egdbslotlimit) {
+            i = egdbslotsused++;
+        } else {
+            uint16_t *link;
+
+            /* take the oldest slot off the list and out of its bucket */
+            i = egdboldest;
+            slot = &egdbcacheslots[i];
+            egdboldest = slot->newer;
+            if(egdboldest != EGDB_NOSLOT) {
+                egdbcacheslots[egdboldest].older = EGDB_NOSLOT;
+            } else {
+                egdbnewest = EGDB_NOSLOT;
+            }
+            link = &egdbbuckets[((uint32_t)(slot->slice - egdbslices) * 40503u + slot->block) & (EGDB_CACHEBLOCKS - 1)];
+            while(*link != i) {
+                link = &egdbcacheslots[*link].next;
+            }
+            *link = slot->next;
+        }
+        slot = &egdbcacheslots[i];
+        slot->slice = slice;
+        slot->block = block;
+        slot->next = *bucket;
+        *bucket = i;
+        start = egdbread32(slice->offsets + 4 * block);
+        end = egdbread32(slice->offsets + 4 * block + 4);
+        egdbunpack(slice->data + start, end - start, slot->values, EGDB_BLOCK);
+        if(egdbnewest == EGDB_NOSLOT) {
+            slot->older = slot->newer = EGDB_NOSLOT;
+            egdbnewest = egdboldest = i;
+            return(slot->values);
+        }
+    } else {
+        slot = &egdbcacheslots[i];
+        if(i == egdbnewest) {
+            return(slot->values);
+        }
+        /* unlink, to be put back as the newest */
+        egdbcacheslots[slot->newer].older = slot->older;
+        if(slot->older != EGDB_NOSLOT) {
+            egdbcacheslots[slot->older].newer = slot->newer;
+        } else {
+            egdboldest = slot->newer;
+        }
+    }
+    slot->older = egdbnewest;
+    slot->newer = EGDB_NOSLOT;
+    egdbcacheslots[egdbnewest].newer = i;
+    egdbnewest = i;
+    return(slot->values);
+}
+
+/**
+ * value of the index-th position of a slice
+ */
+int egdbprobeindex(struct egdbslice *slice, uint32_t index) {
+    egdbprobes++;
+    return(egdbvalue(egdbblock(slice, index / EGDB_BLOCKPOSITIONS), index % EGDB_BLOCKPOSITIONS));
+}
+
+/**
+ * checks a table header, returns the number of positions or 0
+ */
+uint32_t egdbheader(const uint8_t *header, const uint8_t pieces[4]) {
+    uint32_t size;
+
+    if(memcmp(header, "WLD", 3) != 0 || header[3] != EGDB_VERSION || memcmp(header + 4, pieces, 4) != 0) {
+        return(0);
+    }
+    size = egdbread32(header + 8);
+    return(size == egdbsize(pieces) ? size : 0);
+}
+
+/**
+ * adds a table to the ones probed, file is all of the table file. returns
+ * 0 if there is no room or the file does not hold the table of pieces.
+ * egdbblock() trusts the block offsets, so they are checked here: each
+ * block must start where the one before ended or later, and the last end
+ * where the file does
+ */
+int egdbadd(const uint8_t pieces[4], const uint8_t *file, uint32_t length) {
+    struct egdbslice *slice;
+    const uint8_t *offsets = file + EGDB_HEADER;
+    uint32_t size, blocks, i;
+    int n = pieces[0] + pieces[1] + pieces[2] + pieces[3];
+
+    if(egdbcount == EGDB_SLICES || n > EGDB_MAXPIECES || length < EGDB_HEADER ||
+       (size = egdbheader(file, pieces)) == 0) {
+        return(0);
+    }
+    blocks = (egdbbytes(size) + EGDB_BLOCK - 1) / EGDB_BLOCK;
+    if(length < EGDB_HEADER + 4 * (blocks + 1) ||
+       length != EGDB_HEADER + 4 * (blocks + 1) + egdbread32(offsets + 4 * blocks)) {
+        return(0);
+    }
+    for(i = 0; i < blocks; i++) {
+        if(egdbread32(offsets + 4 * i + 4) < egdbread32(offsets + 4 * i)) {
+            return(0);
+        }
+    }
+    if(egdbcount == 0) {
+        egdbcache((uint32_t)egdbslotlimit * EGDB_BLOCK);
+    }
+    slice = &egdbslices[egdbcount++];
+    memcpy(slice->pieces, pieces, 4);
+    slice->size = size;
+    slice->blocks = blocks;
+    slice->offsets = offsets;
+    slice->data = offsets + 4 * (blocks + 1);
+    if(n > egdbpieces) {
+        egdbpieces = n;
+    }
+    return(1);
+}
+
+/**
+ * the loaded slice of the signature, or NULL
+ */
+struct egdbslice *egdbfind(const uint8_t pieces[4]) {
+    int i;
+
+    if(egdblast != NULL && memcmp(egdblast->pieces, pieces, 4) == 0) {
+        return(egdblast);
+    }
+    for(i = 0; i < egdbcount; i++) {
+        if(memcmp(egdbslices[i].pieces, pieces, 4) == 0) {
+            egdblast = &egdbslices[i];
+            return(egdblast);
+        }
+    }
+    return(NULL);
+}
+
+/**
+ * value of a position with black to move, UNKNOWN if its slice is not loaded
+ */
+int egdblookup(const struct egdbposition *pos) {
+    struct egdbslice *slice;
+    uint8_t pieces[4];
+
+    pieces[0] = egdbsquares(pos->blackmen);
+    pieces[1] = egdbsquares(pos->blackkings);
+    pieces[2] = egdbsquares(pos->whitemen);
+    pieces[3] = egdbsquares(pos->whitekings);
+    if((slice = egdbfind(pieces)) == NULL) {
+        return(UNKNOWN);
+    }
+    return(egdbprobeindex(slice, egdbindex(pos, pieces)));
+}
+
+/**
+ * name of the table of the slice: the file in dir on the host, the
+ * appvar on the calc
+ */
+void egdbname(char *name, const char *dir, const uint8_t pieces[4]) {
+#ifdef HOST_BUILD
+    sprintf(name, "%s/E%d%d%d%d.wld", dir, pieces[0], pieces[1], pieces[2], pieces[3]);
+#else
+    int i;
+
+    (void)dir;
+    name[0] = 'E';
+    for(i = 0; i < 4; i++) {
+        name[i + 1] = '0' + pieces[i];
+    }
+    name[5] = '\0';
+#endif
+}
+
+/**
+ * maps every table of up to maxpieces pieces found in dir, which the calc
+ * ignores. returns the number of tables loaded
+ */
+int egdbload(const char *dir, int maxpieces) {
+    uint8_t pieces[4];
+    int loaded = 0;
+    int n;
+
+    egdbinit();
+    for(n = 2; n <= maxpieces && n <= EGDB_MAXPIECES; n++) {
+        for(pieces[0] = 0; pieces[0] <= n; pieces[0]++) {
+            for(pieces[1] = 0; pieces[0] + pieces[1] <= n; pieces[1]++) {
+                for(pieces[2] = 0; pieces[0] + pieces[1] + pieces[2] <= n; pieces[2]++) {
+#ifdef HOST_BUILD
+                    char name[512];
+#else
+                    char name[9];
+#endif
+                    const uint8_t *file;
+                    uint32_t length;
+
+                    pieces[3] = n - pieces[0] - pieces[1] - pieces[2];
+                    if(pieces[0] + pieces[1] == 0 || pieces[2] + pieces[3] == 0) {
+                        continue;
+                    }
+                    egdbname(name, dir, pieces);
+                    if((file = tableopen(name, &length)) == NULL) {
+                        continue;
+                    }
+                    if(egdbadd(pieces, file, length)) {
+                        loaded++;
+                    } else {
+                        tableclose(file, length);
+                    }
+                }
+            }
+        }
+    }
+    return(loaded);
+}
+
+#endif
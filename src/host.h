@@ -0,0 +1,15 @@
+#ifndef HOST_H
+#define HOST_H
+
+/**
+ * stand-ins for the calculator libraries when the engine is built on a host
+ * with -DHOST_BUILD, see tools/
+ */
+#include <stdio.h>
+
+#define dbg_printf(...) fprintf(stderr, __VA_ARGS__)
+
+/* the host has no keypad, searches are stopped through *playnow */
+#define os_GetCSC() 0
+
+#endif
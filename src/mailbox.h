@@ -0,0 +1,117 @@
+/**
+ * move generation on the cboard mailbox, the default board backend.
+ * included by side.h once per side, see there for SIDED and friends.
+ * with MOVEGEN_TABLES the steps and jumps loop over the directions of
+ * the neighbor and landing tables instead of being unrolled.
+ */
+
+/**
+ * purpose:generates all moves. no captures. returns number of moves
+ */
+int SIDED(generatemovelist)(struct move2 movelist[MAXMOVES]) {
+    int n = 0;
+    int i;
+
+    for(i = 5; i <= 40; i++) {
+        if( (cboard[i] & SIDE) != 0 ) {
+#if MOVEGEN_TABLES
+            const uint8_t *to = neighbor[i];
+            int d;
+
+            if( (cboard[i] & MAN) != 0 ) {
+                int after = PROMOTES(i) ? (SIDE | KING) : (SIDE | MAN);
+                for(d = FORWARD; d < FORWARD + 2; d++) {
+                    if( (cboard[to[d]] & FREE) != 0 ) {
+                        ADDSTEP(i, to[d], SIDE | MAN, after);
+                    }
+                }
+            } else { /* cboard[i] is a KING */
+                for(d = 0; d < 4; d++) {
+                    if( (cboard[to[d]] & FREE) != 0 ) {
+                        ADDSTEP(i, to[d], SIDE | KING, SIDE | KING);
+                    }
+                }
+            }
+#else
+            if( (cboard[i] & MAN) != 0 ) {
+                int after = PROMOTES(i) ? (SIDE | KING) : (SIDE | MAN);
+                if( (cboard[i + AHEAD] & FREE) != 0 ) {
+                    ADDSTEP(i, i + AHEAD, SIDE | MAN, after);
+                }
+                if( (cboard[i + AHEAD2] & FREE) != 0 ) {
+                    ADDSTEP(i, i + AHEAD2, SIDE | MAN, after);
+                }
+            } else { /* cboard[i] is a KING */
+                if( (cboard[i + 4] & FREE) != 0 ) {
+                    ADDSTEP(i, i + 4, SIDE | KING, SIDE | KING);
+                }
+                if( (cboard[i + 5] & FREE) != 0 ) {
+                    ADDSTEP(i, i + 5, SIDE | KING, SIDE | KING);
+                }
+                if( (cboard[i - 4] & FREE) != 0 ) {
+                    ADDSTEP(i, i - 4, SIDE | KING, SIDE | KING);
+                }
+                if( (cboard[i - 5] & FREE) != 0 ) {
+                    ADDSTEP(i, i - 5, SIDE | KING, SIDE | KING);
+                }
+            }
+#endif
+        }
+    }
+    return(n);
+}
+
+/**
+ * generate all possible captures
+ */
+int SIDED(generatecapturelist)(struct move2 movelist[MAXMOVES]) {
+    int n = 0;
+    int i;
+
+    for(i = 5; i <= 40; i++) {
+        if( (cboard[i] & SIDE) != 0) {
+            capturesequences(&n, movelist, i);
+        }
+    }
+    return(n);
+}
+
+/**
+ * purpose: test if the side to move has a capture on cboard
+ */
+int SIDED(testcapture)(void) {
+    int i;
+
+    for(i = 5; i <= 40; i++) {
+        if( (cboard[i] & SIDE) != 0) {
+#if MOVEGEN_TABLES
+            int d, last = (cboard[i] & KING) != 0 ? 4 : 2;
+
+            /* a king also looks back, the directions after the forward ones */
+            for(d = 0; d < last; d++) {
+                int dir = (FORWARD + d) & 3;
+
+                if( (cboard[neighbor[i][dir]] & ENEMY) != 0 && (cboard[landing[i][dir]] & FREE) != 0 ) {
+                    return(1);
+                }
+            }
+#else
+            if( (cboard[i + AHEAD] & ENEMY) != 0 && (cboard[i + 2 * AHEAD] & FREE) != 0 ) {
+                return(1);
+            }
+            if( (cboard[i + AHEAD2] & ENEMY) != 0 && (cboard[i + 2 * AHEAD2] & FREE) != 0 ) {
+                return(1);
+            }
+            if( (cboard[i] & KING) != 0 ) {
+                if( (cboard[i - AHEAD] & ENEMY) != 0 && (cboard[i - 2 * AHEAD] & FREE) != 0 ) {
+                    return(1);
+                }
+                if( (cboard[i - AHEAD2] & ENEMY) != 0 && (cboard[i - 2 * AHEAD2] & FREE) != 0 ) {
+                    return(1);
+                }
+            }
+#endif
+        }
+    }
+    return(0);
+}
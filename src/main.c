@@ -24,8 +24,9 @@
 
 #include "simplech.h"
 
-/* version info */
-#define VERSION       2
+/* save file info */
+#define SAVE_MAGIC    "CHK"
+#define VERSION       5
 
 #define GRAY_COLOR    0x4A
 
@@ -43,6 +44,20 @@
 #define USER_INPUT    0
 #define AI_INPUT      1
 
+/* plies kept for undo, the oldest ones are dropped first */
+#define MAX_HISTORY   256
+
+/* the exported game record wraps its moves before this column */
+#define PDN_COLUMNS   72
+#define START_FEN     "B:W21,22,23,24,25,26,27,28,29,30,31,32:B1,2,3,4,5,6,7,8,9,10,11,12"
+
+/* hints, the search time in ms and the box color of the best move */
+#define HINT_TIME     2000
+#define HINT_COLOR    0x1C
+
+/* nodes the calc searches between two looks at the keypad */
+#define SEARCH_SLICE  64
+
 /* globals */
 /* board[0][0] is bottom left corner */
 /* board[7][7] is top right corner */
@@ -51,6 +66,7 @@ uint8_t board[8][8];
 /* Put function prototypes here */
 void print_settings(void);
 void get_settings(void);
+bool settings_hidden(uint8_t item);
 void init_board(void);
 void draw_board(void);
 void print_home(void);
@@ -66,9 +82,20 @@ int check_jump(int8_t row, int8_t col);
 bool check_move(void);
 bool check_board_jumps(void);
 void draw_controls(void);
-void load_save(void);
+bool load_save(void);
 void save_save(void);
+void export_pdn(const char *result);
+void pdn_write(ti_var_t file, const char *str, uint8_t *column);
 void draw_red_text(char *text, uint16_t x, uint8_t y);
+bool think(gamemove_t *move, int *exit_key);
+void history_push(const gamemove_t *move);
+bool history_fits(uint8_t b[8][8], const gamemove_t *move, bool undo);
+bool history_valid(void);
+bool undo_move(void);
+bool redo_move(void);
+void redraw_game(void);
+void draw_stats(void);
+void draw_hints(void);
 
 const char *me = "matt \"mateoconlechuga\" waltz";
 const char *them = "engine by martin fierz";
@@ -78,6 +105,7 @@ const char *settings_str = "game setup";
 const char *mode_str = "mode";
 const char *play_as_str = "play as";
 const char *will_start_str = "will start";
+const char *level_str = "level";
 const char *no_str = "no";
 const char *yes_str = "yes";
 const char *human1_str = "human v calc";    // mode 0
@@ -85,11 +113,13 @@ const char *calc2_str = "calc v calc";      // mode 1
 const char *human2_str = "human v human";   // mode 2
 const char *black_str = "black";
 const char *white_str = "white";
+const char *level_strs[LEVELS] = { "easy", "medium", "hard", "expert" };
 const char *arrows_str = "use the <> arrows to set";
 const char *info_str = "these settings will only affect a new game";
 const char *white_turn_str = "white's turn";
 const char *black_turn_str = "black's turn";
 const char *appvar_name = "checkers";
+const char *pdn_name = "CHKPDN";
 
 typedef struct player_struct {
 	int8_t row;
@@ -107,8 +137,47 @@ typedef struct settings_struct {
 	int8_t mode;
 	uint8_t start;
 	uint8_t playingas;
+	uint8_t level;
 } settings_t;
 
+/* rows of the settings screen */
+#define SETTINGS_ITEMS 4
+#define DEFAULT_LEVEL  1
+
+/**
+ * packed save file layout, read in place from the archived appvar
+ * squares are numbered 0..31 by SQ_INDEX, one bit per playable square
+ * history_len gamemove_t entries follow the header
+ */
+typedef struct save_struct {
+	char magic[3];
+	uint8_t version;
+	uint32_t black;
+	uint32_t white;
+	uint32_t kings;
+	uint16_t steps;
+	uint8_t current_player;
+	uint8_t mode;
+	uint8_t start;
+	uint8_t playingas;
+	uint8_t level;
+	uint8_t cursor[2][3];
+	uint16_t history_len;
+	uint16_t history_pos;
+	uint16_t checksum;
+} save_t;
+
+/* cursor bytes of a saved player */
+#define SAVE_POS      0
+#define SAVE_SEL      1
+#define SAVE_FLAGS    2
+#define SAVE_DRAW_SEL 1
+#define SAVE_JUMPING  2
+
+uint16_t save_checksum(uint16_t sum, const uint8_t *data, size_t len);
+bool save_valid(const save_t *save);
+uint8_t count_bits(uint32_t bits);
+
 /* some fast access globals */
 uint8_t home_item;
 uint8_t settings_item;
@@ -117,20 +186,48 @@ settings_t settings;
 player_t player[2];
 uint8_t current_player;
 uint8_t play_as;
+bool show_stats;
+
+/* last hint analysis, kept until the position changes */
+analysis_t hint;
+
+/* game record, history_pos is the number of plies currently on the board */
+gamemove_t history[MAX_HISTORY];
+uint16_t history_len;
+uint16_t history_pos;
 
 /* Put all your code here */
 void main(void) {
 	ti_var_t savefile;
+#if MEMORY_PROFILE
+	memprofstart();
+#endif
 	gfx_Begin( gfx_8bpp );
+	settings.level = DEFAULT_LEVEL;
+
+#if EGDB
+	/* endgame tables are probed straight out of the archive */
+	egdbload(NULL, EGDB_MAXPIECES);
+#endif
+#if BOOK
+	bookload(NULL);
+#endif
 	
 	/* enter the main game loop */
 	game_loop();
+#if MEMORY_PROFILE
+	memprofreport("exit");
+#endif
 
-	/* archive the save file */
+	/* archive the save file and the game record */
 	if( (savefile = ti_Open(appvar_name,"r")) ) {
 		ti_SetArchiveStatus(true,savefile);
 	}
 	ti_CloseAll();
+	if( (savefile = ti_Open(pdn_name,"r")) ) {
+		ti_SetArchiveStatus(true,savefile);
+	}
+	ti_CloseAll();
 	
 	/* close the graphics and return to the OS */
 	gfx_End();
@@ -259,13 +356,9 @@ void game_loop(void) {
 		gfx_palette[WHITE_COLOR] = gfx_RGBTo1555(234, 208, 151);
 		gfx_palette[SEP_COLOR] = gfx_RGBTo1555(143, 106, 64);
 
-		/* reset the board */
-		init_board();
-
 		/* check if we need to load the save file */
-		if (home_item == 1) {
-			load_save();
-		} else {
+		if (home_item != 1 || !load_save()) {
+			init_board();
 			game_reset();
 		}
 		draw_board();
@@ -280,6 +373,7 @@ void game_loop(void) {
  */
 void game_reset(void) {
 	steps = 0;
+	history_len = history_pos = 0;
 	current_player = settings.start;
 	memset(&player[0], 0, sizeof(player_t));
 	memset(&player[1], 0, sizeof(player_t));
@@ -323,28 +417,32 @@ void get_settings(void) {
 
 		/* down pressed */
 		if (key == 0x01) {
-			settings_item = (settings_item + 1) % 3;
-			if (settings.mode) {
-				settings_item = 2;
-			}
+			do {
+				settings_item = (settings_item + 1) % SETTINGS_ITEMS;
+			} while (settings_hidden(settings_item));
 		}
 		/* up pressed */
 		if (key == 0x04) {
-			settings_item = settings_item - 1 < 0 ? 2 : settings_item - 1;
-			if (settings.mode) {
-				settings_item = 0;
-			}
+			do {
+				settings_item = settings_item - 1 < 0 ? SETTINGS_ITEMS - 1 : settings_item - 1;
+			} while (settings_hidden(settings_item));
 		}
 		/* left pressed */
 		if (key == 0x02) {
 			if(settings_item == 0) {
 				settings.mode = settings.mode - 1 < 0 ? 2 : settings.mode - 1;
 			}
+			if(settings_item == 3) {
+				settings.level = settings.level - 1 < 0 ? LEVELS - 1 : settings.level - 1;
+			}
 		}
 		/* right pressed */
 		if (key == 0x03) {
 			if(settings_item == 0) {
-				settings.mode = (settings.mode + 1) & 3;
+				settings.mode = (settings.mode + 1) % 3;
+			}
+			if(settings_item == 3) {
+				settings.level = (settings.level + 1) % LEVELS;
 			}
 		}
 		if (key == 0x03 || key == 0x02) {
@@ -362,6 +460,20 @@ void get_settings(void) {
 	}
 }
 
+/**
+ * true for the settings rows that do not apply to the selected mode
+ */
+bool settings_hidden(uint8_t item) {
+	switch(item) {
+	case 1:
+		return settings.mode != 0;
+	case 3:
+		return settings.mode == 2;
+	default:
+		return false;
+	}
+}
+
 /**
  * returns true if the move was valid
  * also executes the move
@@ -376,6 +488,8 @@ bool check_move() {
 	uint8_t old = board[oldx][oldy];
 	int8_t diffx, diffy;
 	bool force_jump = false;
+	bool continued = player[current_player].jumping;
+	gamemove_t move;
 
 	if ((x == oldx && y == oldy)) {
 		return false;
@@ -403,6 +517,7 @@ bool check_move() {
 		if (!(old & KING) && diffy != (play_as == WHITE ? -1 : 1)) {
 			return false;
 		}
+		move.captured = move.capkings = 0;
 		board[x][y] = board[oldx][oldy];
 		board[oldx][oldy] = FREE;
 		goto ret_true;
@@ -417,6 +532,8 @@ bool check_move() {
 		}
 		val = board[x - diffx / 2][y - diffy / 2];
 		if (((val & WHITE) && (play_as == BLACK)) || ((val & BLACK) && (play_as == WHITE))) {
+			move.captured = (uint32_t)1 << SQ_INDEX(x - diffx / 2, y - diffy / 2);
+			move.capkings = (val & KING) ? move.captured : 0;
 			board[x][y] = board[oldx][oldy];
 			board[oldx][oldy] = FREE;
 			board[x - diffx / 2][y - diffy / 2] = FREE;
@@ -432,9 +549,85 @@ ret_true:
 		board[x][y] |= KING;
 		board[x][y] &= ~MAN;
 	}
+
+	/* record the move, further jumps extend the same ply */
+	if (continued && history_pos) {
+		gamemove_t *last = &history[history_pos - 1];
+		last->to = SQ_INDEX(x, y);
+		last->after = board[x][y];
+		last->captured |= move.captured;
+		last->capkings |= move.capkings;
+	} else {
+		move.from = SQ_INDEX(oldx, oldy);
+		move.to = SQ_INDEX(x, y);
+		move.piece = old;
+		move.after = board[x][y];
+		history_push(&move);
+	}
 	return true;
 }
 
+/**
+ * appends a ply to the game record, dropping any redo moves
+ */
+void history_push(const gamemove_t *move) {
+	if (history_pos == MAX_HISTORY) {
+		memmove(&history[0], &history[1], (MAX_HISTORY - 1) * sizeof(gamemove_t));
+		history_pos--;
+	}
+	history[history_pos++] = *move;
+	history_len = history_pos;
+}
+
+/**
+ * takes back one ply, an unfinished jump is taken back without passing the turn
+ * returns false if there is nothing to take back
+ */
+bool undo_move(void) {
+	if (!history_pos) {
+		return false;
+	}
+	unmakegamemove(board, &history[--history_pos]);
+	if (player[current_player].jumping) {
+		player[current_player].jumping = false;
+	} else {
+		current_player ^= 1;
+	}
+	player[current_player].draw_selection = false;
+	if (steps) {
+		steps--;
+	}
+	play_as = get_player_color();
+	return true;
+}
+
+/**
+ * replays one ply that was taken back
+ * returns false if there is nothing to replay
+ */
+bool redo_move(void) {
+	if (history_pos == history_len || player[current_player].jumping) {
+		return false;
+	}
+	makegamemove(board, &history[history_pos++]);
+	player[current_player].draw_selection = false;
+	current_player ^= 1;
+	steps++;
+	play_as = get_player_color();
+	return true;
+}
+
+/**
+ * redraws the board and the turn info after the position changed
+ */
+void redraw_game(void) {
+	gfx_SetDrawBuffer();
+	draw_board();
+	draw_controls();
+	gfx_SwapDraw();
+	gfx_SetDrawScreen();
+}
+
 /**
  * prints the settings text
  */
@@ -465,7 +658,7 @@ void print_settings(void) {
 	gfx_PrintString(play_as_str);
 	gfx_PrintStringXY(settings.playingas ? white_str : black_str, 180, (240 - 8) / 2 + 22);
 
-	if (settings.mode) {
+	if (settings_hidden(1)) {
 		gfx_SetColor( BACK_COLOR );
 		gfx_HorizLine_NoClip(85, (240 - 8) / 2 + 26, 320 - 95);
 		gfx_SetColor( GRAY_COLOR );
@@ -475,6 +668,17 @@ void print_settings(void) {
 	gfx_PrintString(settings_item == 2 ? "\x10 " : "");
 	gfx_PrintString(will_start_str);
 	gfx_PrintStringXY(settings.start ? white_str : black_str, 180, (240 - 8) / 2 + 34);
+
+	gfx_SetTextXY(85, (240 - 8) / 2 + 46);
+	gfx_PrintString(settings_item == 3 ? "\x10 " : "");
+	gfx_PrintString(level_str);
+	gfx_PrintStringXY(level_strs[settings.level], 180, (240 - 8) / 2 + 46);
+
+	if (settings_hidden(3)) {
+		gfx_SetColor( BACK_COLOR );
+		gfx_HorizLine_NoClip(85, (240 - 8) / 2 + 50, 320 - 95);
+		gfx_SetColor( GRAY_COLOR );
+	}
 	
 	gfx_PrintStringXY(arrows_str, (320 - gfx_GetStringWidth(arrows_str)) / 2, 240 - 16);
 	gfx_PrintStringXY(info_str, (320 - gfx_GetStringWidth(info_str)) / 2, 240 - 16 - 16);
@@ -499,6 +703,54 @@ void draw_red_text(char *text, uint16_t x, uint8_t y) {
 	gfx_SetTextFGColor( GRAY_COLOR );
 }
 
+/**
+ * finds the calc's move, searching SEARCH_SLICE nodes at a time. between
+ * slices the thinking text and the share of the node budget spent are
+ * drawn with the best move of the last depth done; clear leaves the game
+ * and 2nd or enter plays that move now
+ */
+bool think(gamemove_t *move, int *exit_key) {
+	static char *dots[4] = { "thinking", "thinking.", "thinking..", "thinking..." };
+	uint8_t frame = 0, shown = 0, depth, spent, key;
+	gamemove_t best;
+
+	setgamehistory(board, play_as, history, history_pos);
+	if (!searchstart(board, play_as, exit_key)) {
+		return false;
+	}
+	while (searchrun(SEARCH_SLICE)) {
+		key = os_GetCSC();
+		if (key == sk_Clear) {
+			*exit_key = 1;
+			return false;
+		}
+		if (key == sk_Enter || key == sk_2nd) {
+			searchstop();
+		}
+		if (!(frame++ % 8)) {
+			gfx_SetColor( BACK_COLOR );
+			gfx_FillRectangle_NoClip(239, (240 - 8) / 2, 320 - 239, 8);
+			draw_red_text(dots[frame / 8 % 4], 239, (240 - 8) / 2);
+		}
+		depth = searchinfo(&best, &spent);
+		gfx_SetColor( gfx_red );
+		gfx_FillRectangle_NoClip(239, (240 - 8) / 2 + 10, (spent > 100 ? 100 : spent) * 64 / 100, 2);
+		if (depth != shown) {
+			shown = depth;
+			gfx_SetColor( BACK_COLOR );
+			gfx_FillRectangle_NoClip(239, (240 - 8) / 2 + 14, 320 - 239, 8);
+			gfx_SetTextXY(239, (240 - 8) / 2 + 14);
+			gfx_PrintString("d");
+			gfx_PrintUInt(depth, 1);
+			gfx_PrintString(" ");
+			gfx_PrintUInt(SQ_NUMBER(best.from), 1);
+			gfx_PrintString("-");
+			gfx_PrintUInt(SQ_NUMBER(best.to), 1);
+		}
+	}
+	return searchresult(board, move);
+}
+
 /**
  * runs the actual game
  */
@@ -506,11 +758,14 @@ void run_game(void) {
 	uint8_t row, col;
 	uint8_t key = 1;
 	int exit_key = 0;
+	gamemove_t move;
 	play_as = get_player_color();
 
 	player[0].jumping = false;
 	player[1].jumping = false;
 
+	setlevel(settings.level);
+
 	switch(settings.mode) {
 	case 0:
 		player[settings.playingas].input = USER_INPUT;
@@ -535,12 +790,13 @@ void run_game(void) {
 	/* wait until 2nd or enter is pressed before continuing */
 	while(key != 0x0F) {
 		if (player[current_player].input == AI_INPUT) {
-			draw_red_text("thinking...", 239, (240 - 8) / 2);
-			getmove(board, play_as, &exit_key);
-			steps++;
+			if (think(&move, &exit_key)) {
+				history_push(&move);
+			}
 			if (exit_key) {
 				break;
 			}
+			steps++;
 			gfx_SetDrawBuffer();
 			draw_board();
 			current_player ^= 1;
@@ -585,6 +841,37 @@ void run_game(void) {
 		if (key == 0x02) {
 			player[current_player].col = player[current_player].col - 1 < 0 ? 7 : player[current_player].col - 1;
 		}
+		/* del pressed, take back a move (and the reply of the calc) */
+		if (key == sk_Del) {
+			if (undo_move()) {
+				while (player[current_player].input == AI_INPUT && settings.mode != 1 && undo_move());
+				redraw_game();
+				key = 1;
+			}
+		}
+		/* stat pressed, toggle the search statistics */
+		if (key == sk_Stat) {
+			show_stats = !show_stats;
+			redraw_game();
+			key = 1;
+		}
+		/* graph pressed, show the best moves for the player */
+		if (key == sk_Graph && player[current_player].input == USER_INPUT && !player[current_player].jumping) {
+			draw_red_text("thinking...", 239, (240 - 8) / 2);
+			setgamehistory(board, play_as, history, history_pos);
+			analyze(board, play_as, MAXHINTS, HINT_TIME, &hint);
+			redraw_game();
+			draw_hints();
+			key = 1;
+		}
+		/* mode pressed, replay a move that was taken back */
+		if (key == sk_Mode) {
+			if (redo_move()) {
+				while (player[current_player].input == AI_INPUT && settings.mode != 1 && redo_move());
+				redraw_game();
+				key = 1;
+			}
+		}
 		if (key == 0x30) {
 			if (player[current_player].jumping == false) {
 				draw_box(BACK_COLOR, player[current_player].selcol, player[current_player].selrow);
@@ -624,7 +911,8 @@ void run_game(void) {
 			}
 		}
 	}
-	/* save everything */
+	/* save everything, a game that was left goes on */
+	export_pdn("*");
 	save_save();
 	gfx_SetDrawBuffer();
 }
@@ -659,6 +947,55 @@ void draw_controls(void) {
 	gfx_PrintStringXY(current_player ? black_turn_str : white_turn_str, 230, 15);
 	gfx_PrintStringXY("steps - ", 230, 49);
 	gfx_PrintUInt(steps, 4);
+	if (show_stats) {
+		draw_stats();
+	}
+}
+
+/**
+ * draws the statistics of the last calc search below the controls
+ */
+void draw_stats(void) {
+#if SEARCH_STATS
+	gfx_PrintStringXY("nodes ", 230, 150);
+	gfx_PrintUInt(searchstats.nodes, 1);
+	gfx_PrintStringXY("depth ", 230, 162);
+	gfx_PrintUInt(searchstats.depth, 1);
+	gfx_PrintString("/");
+	gfx_PrintUInt(searchstats.seldepth, 1);
+	gfx_PrintStringXY("score ", 230, 174);
+	gfx_PrintInt(searchstats.score, 1);
+	gfx_PrintStringXY("time ", 230, 186);
+	gfx_PrintUInt(searchstats.time, 1);
+	gfx_PrintString("ms");
+	if (searchstats.pvlength) {
+		gfx_PrintStringXY("pv ", 230, 198);
+		gfx_PrintUInt(searchstats.pv[0][0], 1);
+		gfx_PrintString(searchstats.pv[0][2] ? "x" : "-");
+		gfx_PrintUInt(searchstats.pv[0][1], 1);
+	}
+#endif
+}
+
+/**
+ * shows the moves the engine suggests, the best one boxed on the board
+ * and the list with scores for the player to move next to it
+ */
+void draw_hints(void) {
+	uint8_t i;
+
+	for (i = 0; i < hint.count; i++) {
+		gfx_SetTextXY(230, 66 + i * 12);
+		gfx_PrintUInt(SQ_NUMBER(hint.move[i].from), 1);
+		gfx_PrintString(hint.move[i].captured ? "x" : "-");
+		gfx_PrintUInt(SQ_NUMBER(hint.move[i].to), 1);
+		gfx_PrintString("  ");
+		gfx_PrintInt(hint.score[i], 1);
+	}
+	if (hint.count) {
+		draw_box(HINT_COLOR, SQ_COL(hint.move[0].from), SQ_ROW(hint.move[0].from));
+		draw_box(HINT_COLOR, SQ_COL(hint.move[0].to), SQ_ROW(hint.move[0].to));
+	}
 }
 
 /**
@@ -734,84 +1071,335 @@ bool can_jump(int8_t c1, int8_t r1, int8_t c2, int8_t r2, int8_t c3, int8_t r3)
 	return true;
 }
 
+/**
+ * fletcher-16 over the save data, continuing from a previous sum
+ */
+uint16_t save_checksum(uint16_t sum, const uint8_t *data, size_t len) {
+	uint16_t sum1 = sum & 255;
+	uint16_t sum2 = sum >> 8;
+	while (len--) {
+		sum1 = (sum1 + *data++) % 255;
+		sum2 = (sum2 + sum1) % 255;
+	}
+	return (sum2 << 8) | sum1;
+}
+
+/**
+ * returns the number of set bits
+ */
+uint8_t count_bits(uint32_t bits) {
+	uint8_t n = 0;
+	while (bits) {
+		bits &= bits - 1;
+		n++;
+	}
+	return n;
+}
+
+/**
+ * returns true if the save can be loaded without breaking the game state
+ */
+bool save_valid(const save_t *save) {
+	uint8_t i;
+	uint16_t sum;
+	if (memcmp(save->magic, SAVE_MAGIC, sizeof(save->magic)) || save->version != VERSION) {
+		return false;
+	}
+	if (save->history_pos > save->history_len || save->history_len > MAX_HISTORY) {
+		return false;
+	}
+	sum = save_checksum(0, (const uint8_t*)save, offsetof(save_t, checksum));
+	sum = save_checksum(sum, (const uint8_t*)(save + 1), save->history_len * sizeof(gamemove_t));
+	if (save->checksum != sum) {
+		return false;
+	}
+	if ((save->black & save->white) || (save->kings & ~(save->black | save->white))) {
+		return false;
+	}
+	if (count_bits(save->black) > 12 || count_bits(save->white) > 12) {
+		return false;
+	}
+	if (save->current_player > 1 || save->mode > 2 || save->start > 1 || save->playingas > 1 || save->level >= LEVELS) {
+		return false;
+	}
+	for (i = 0; i < 2; i++) {
+		if (save->cursor[i][SAVE_FLAGS] & ~(SAVE_DRAW_SEL | SAVE_JUMPING)) {
+			return false;
+		}
+	}
+	return true;
+}
+
 /**
  * loads the save file
+ * returns false and leaves the game untouched if there is no valid save
  */
-void load_save(void) {
-	ti_var_t save;
+bool load_save(void) {
+	ti_var_t file;
+	const save_t *save;
+	uint8_t i, x, y;
+	uint32_t bit;
 
 	ti_CloseAll();
 
-	save = ti_Open(appvar_name, "r+");
+	if (!(file = ti_Open(appvar_name, "r"))) {
+		return false;
+	}
 
-	if(save) {
-		if (ti_GetC(save) == VERSION) {
-			if (ti_Read(board, sizeof(board), 1, save) != 1) {
-				return;
-			}
-			if (ti_Read(&settings, sizeof(settings_t), 1, save) != 1) {
-				return;
-			}
-			if (ti_Read(&player[0], sizeof(player_t), 1, save) != 1) {
-				return;
-			}
-			if (ti_Read(&player[1], sizeof(player_t), 1, save) != 1) {
-				return;
-			}
-			if (ti_Read(&steps, sizeof(unsigned), 1, save) != 1) {
-				return;
-			}
-			if (ti_Read(&current_player, sizeof(unsigned), 1, save) != 1) {
-				return;
-			}
+	/* read straight out of the archive */
+	save = ti_GetDataPtr(file);
+	if (ti_GetSize(file) < sizeof(save_t) ||
+	    ti_GetSize(file) != sizeof(save_t) + save->history_len * sizeof(gamemove_t) ||
+	    !save_valid(save)) {
+		ti_CloseAll();
+		return false;
+	}
+
+	for (i = 0, bit = 1; i < 32; i++, bit <<= 1) {
+		x = SQ_COL(i);
+		y = SQ_ROW(i);
+		if (save->black & bit) {
+			board[x][y] = BLACK | ((save->kings & bit) ? KING : MAN);
+		} else if (save->white & bit) {
+			board[x][y] = WHITE | ((save->kings & bit) ? KING : MAN);
 		} else {
-			return;
+			board[x][y] = FREE;
 		}
 	}
 
+	settings.mode = save->mode;
+	settings.start = save->start;
+	settings.playingas = save->playingas;
+	settings.level = save->level;
+	steps = save->steps;
+	current_player = save->current_player;
+
+	for (i = 0; i < 2; i++) {
+		const uint8_t *cursor = save->cursor[i];
+		memset(&player[i], 0, sizeof(player_t));
+		player[i].row = cursor[SAVE_POS] & 7;
+		player[i].col = cursor[SAVE_POS] >> 3;
+		player[i].selrow = cursor[SAVE_SEL] & 7;
+		player[i].selcol = cursor[SAVE_SEL] >> 3;
+		player[i].draw_selection = (cursor[SAVE_FLAGS] & SAVE_DRAW_SEL) != 0;
+		player[i].jumping = (cursor[SAVE_FLAGS] & SAVE_JUMPING) != 0;
+	}
+
+	history_len = save->history_len;
+	history_pos = save->history_pos;
+	memcpy(history, save + 1, history_len * sizeof(gamemove_t));
+
 	ti_CloseAll();
+
+	/* a record that does not replay onto the saved board is dropped */
+	if (!history_valid()) {
+		history_len = history_pos = 0;
+	}
+	return true;
 }
 
 /**
- * saves the save file
+ * returns true if a history move can be played (or taken back) on b
  */
-void save_save(void) {
-	ti_var_t save;
+bool history_fits(uint8_t b[8][8], const gamemove_t *move, bool undo) {
+	uint8_t i;
+	uint8_t enemy = (move->piece & (BLACK | WHITE)) ^ (BLACK | WHITE);
+	uint32_t bits;
 
-	ti_CloseAll();
+	if (move->from > 31 || move->to > 31 || (move->captured & move->capkings) != move->capkings) {
+		return false;
+	}
+	if (!(move->piece & (BLACK | WHITE)) || (move->after & (BLACK | WHITE)) != (move->piece & (BLACK | WHITE))) {
+		return false;
+	}
+	if (undo) {
+		if (b[SQ_COL(move->to)][SQ_ROW(move->to)] != move->after) {
+			return false;
+		}
+		if (move->from != move->to && b[SQ_COL(move->from)][SQ_ROW(move->from)] != FREE) {
+			return false;
+		}
+	} else {
+		if (b[SQ_COL(move->from)][SQ_ROW(move->from)] != move->piece) {
+			return false;
+		}
+		if (move->from != move->to && b[SQ_COL(move->to)][SQ_ROW(move->to)] != FREE) {
+			return false;
+		}
+	}
+	for (i = 0, bits = move->captured; bits; i++, bits >>= 1) {
+		if (bits & 1) {
+			uint8_t cap = enemy | ((move->capkings >> i) & 1 ? KING : MAN);
+			if (b[SQ_COL(i)][SQ_ROW(i)] != (undo ? FREE : cap)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
 
-	save = ti_Open(appvar_name, "w");
+/**
+ * returns true if the game record replays cleanly in both directions from the board
+ */
+bool history_valid(void) {
+	uint8_t tmp[8][8];
+	uint16_t i;
 
-	if(save) {
-		ti_PutC(VERSION, save);
-		if (ti_Write(board, sizeof(board), 1, save) != 1) {
-			goto err;
+	memcpy(tmp, board, sizeof(board));
+	for (i = history_pos; i--;) {
+		if (!history_fits(tmp, &history[i], true)) {
+			return false;
 		}
-		if (ti_Write(&settings, sizeof(settings_t), 1, save) != 1) {
-			goto err;
+		unmakegamemove(tmp, &history[i]);
+	}
+	memcpy(tmp, board, sizeof(board));
+	for (i = history_pos; i < history_len; i++) {
+		if (!history_fits(tmp, &history[i], false)) {
+			return false;
 		}
-		if (ti_Write(&player[0], sizeof(player_t), 1, save) != 1) {
-			goto err;
+		makegamemove(tmp, &history[i]);
+	}
+	return true;
+}
+
+/**
+ * saves the save file
+ */
+void save_save(void) {
+	ti_var_t file;
+	save_t save;
+	uint8_t i, x, y;
+	uint32_t bit;
+
+	memset(&save, 0, sizeof(save_t));
+	memcpy(save.magic, SAVE_MAGIC, sizeof(save.magic));
+	save.version = VERSION;
+
+	for (i = 0, bit = 1; i < 32; i++, bit <<= 1) {
+		x = SQ_COL(i);
+		y = SQ_ROW(i);
+		if (board[x][y] & BLACK) {
+			save.black |= bit;
 		}
-		if (ti_Write(&player[1], sizeof(player_t), 1, save) != 1) {
-			goto err;
+		if (board[x][y] & WHITE) {
+			save.white |= bit;
 		}
-		if (ti_Write(&steps, sizeof(unsigned), 1, save) != 1) {
-			goto err;
+		if (board[x][y] & KING) {
+			save.kings |= bit;
 		}
-		if (ti_Write(&current_player, sizeof(unsigned), 1, save) != 1) {
-			goto err;
+	}
+
+	save.steps = steps;
+	save.current_player = current_player;
+	save.mode = settings.mode;
+	save.start = settings.start;
+	save.playingas = settings.playingas;
+	save.level = settings.level;
+
+	for (i = 0; i < 2; i++) {
+		save.cursor[i][SAVE_POS] = player[i].row | (player[i].col << 3);
+		save.cursor[i][SAVE_SEL] = player[i].selrow | (player[i].selcol << 3);
+		save.cursor[i][SAVE_FLAGS] = (player[i].draw_selection ? SAVE_DRAW_SEL : 0) |
+		                             (player[i].jumping ? SAVE_JUMPING : 0);
+	}
+	save.history_len = history_len;
+	save.history_pos = history_pos;
+	save.checksum = save_checksum(0, (const uint8_t*)&save, offsetof(save_t, checksum));
+	save.checksum = save_checksum(save.checksum, (const uint8_t*)history, history_len * sizeof(gamemove_t));
+
+	ti_CloseAll();
+
+	if ((file = ti_Open(appvar_name, "w"))) {
+		if (ti_Write(&save, sizeof(save_t), 1, file) != 1 ||
+		    (history_len && ti_Write(history, sizeof(gamemove_t), history_len, file) != history_len)) {
+			ti_CloseAll();
+			ti_Delete(appvar_name);
+			return;
 		}
 	}
 
 	ti_CloseAll();
+}
 
-	return;
-	
-err:
-	ti_Delete(appvar_name);
+/**
+ * writes str to the game record, starting a new line first if it would
+ * go past PDN_COLUMNS
+ */
+void pdn_write(ti_var_t file, const char *str, uint8_t *column) {
+	uint8_t len = strlen(str);
+
+	if (*column) {
+		if (*column + 1 + len > PDN_COLUMNS) {
+			ti_PutC('\n', file);
+			*column = 0;
+		} else {
+			ti_PutC(' ', file);
+			(*column)++;
+		}
+	}
+	ti_Write(str, len, 1, file);
+	*column += len;
+}
+
+/**
+ * exports the plies on the board as a portable draughts notation game to
+ * the PDN appvar, replacing the last one. result is the pdn result, "*"
+ * for a game that is not over. a record that lost its oldest plies starts
+ * from the position it has, given by a FEN tag
+ */
+void export_pdn(const char *result) {
+	uint8_t start[8][8];
+	char str[FENLENGTH + 16];
+	uint8_t color, column = 0;
+	uint16_t i, number = 1;
+	ti_var_t file;
+
+	if (!history_pos) {
+		return;
+	}
+	memcpy(start, board, sizeof(board));
+	for (i = history_pos; i--;) {
+		unmakegamemove(start, &history[i]);
+	}
+	color = history[0].piece & (BLACK | WHITE);
+
+	ti_CloseAll();
+	if (!(file = ti_Open(pdn_name, "w"))) {
+		return;
+	}
+	sprintf(str, "[Event \"Checkers CE\"]\n[Black \"%s\"]\n[White \"%s\"]\n[Result \"%s\"]\n",
+	        player[0].input == USER_INPUT ? "human" : "calc",
+	        player[1].input == USER_INPUT ? "human" : "calc", result);
+	ti_Write(str, strlen(str), 1, file);
+	boardtofen(start, color, str + 6);
+	if (strcmp(str + 6, START_FEN)) {
+		memcpy(str, "[FEN \"", 6);
+		strcat(str, "\"]\n");
+		ti_Write(str, strlen(str), 1, file);
+	}
+	ti_PutC('\n', file);
+
+	for (i = 0; i < history_pos; i++) {
+		/* a move number stays on the line of its move */
+		*str = '\0';
+		if ((history[i].piece & BLACK) || i == 0) {
+			sprintf(str, (history[i].piece & BLACK) ? "%u. " : "%u... ", number);
+		}
+		gamemovetonotation(&history[i], str + strlen(str));
+		pdn_write(file, str, &column);
+		if (history[i].piece & WHITE) {
+			number++;
+		}
+	}
+	pdn_write(file, result, &column);
+	ti_PutC('\n', file);
+	ti_CloseAll();
 }
 
+/**
+ * checks for a finished game: no pieces left, a third repetition or too
+ * many plies without a capture or man move
+ */
 bool game_over(void) {
 	uint8_t ret = 0;
 	uint8_t r, c;
@@ -820,9 +1408,18 @@ bool game_over(void) {
 			ret |= board[c][r] & play_as;
 		}
 	}
+	if (ret && setgamehistory(board, play_as, history, history_pos) == DRAW) {
+		draw_red_text("draw!", 254, (240 - 8) / 2);
+		export_pdn("1/2-1/2");
+		ret = 0;
+	} else if (!ret) {
+		draw_red_text(play_as == BLACK ? "black wins!" : "white wins!", 237, (240 - 8) / 2);
+		/* the record names the colors by the standard board, where the side */
+		/* on 1..12 is black; the side to move has no pieces left */
+		export_pdn(play_as == BLACK ? "0-1" : "1-0");
+	}
 	if (!ret) {
 	uint8_t key;
-		draw_red_text(play_as == BLACK ? "black wins!" : "white wins!", 237, (240 - 8) / 2);
 		do {
 			key = os_GetCSC();
 		} while(key != 0x0F && key != 0x36 && key != 0x09);
@@ -0,0 +1,129 @@
+/**
+ * memory profiling, compiled in with MEMORY_PROFILE: how much of the
+ * stack and of the free RAM the program has touched at its worst, to size
+ * caches and tables by. included by simplech.c.
+ *
+ * memprofstart() paints the memory not in use yet with MEMPROF_PAINT and
+ * memprofreport() looks for the last painted byte, so it sees the deepest
+ * the stack has been and the furthest the heap has grown since the start,
+ * however briefly. searchresult() reports after every search, main() and
+ * tools/bench at the end.
+ *
+ * on the calc the stack is the MEMPROF_STACKSIZE bytes below STACK_HIGH
+ * of the makefile, and the static data and the heap share the region from
+ * BSSHEAP_LOW to BSSHEAP_HIGH: the static data from the bottom, the heap
+ * from the end of it, __heapbot of the linker, up. the report gives
+ *
+ *   memory getmove stack 812/4096 static 41210 heap 0/30000
+ *
+ * the stack used and its size, the static data, and the heap used and
+ * the room it has. on the host there is no such limit, the stack is
+ * measured in the MEMPROF_HOSTSTACK bytes below the caller of
+ * memprofstart(), static is the data and bss of the program, heap how
+ * far brk has grown since memprofstart() and maxrss the most memory the
+ * process held, mapped tables included.
+ */
+
+#ifndef MEMPROF_H
+#define MEMPROF_H
+
+#ifdef HOST_BUILD
+#include <unistd.h>
+#include <sys/resource.h>
+#endif
+
+#define MEMPROF_PAINT 0xA5
+
+#ifdef HOST_BUILD
+#define MEMPROF_HOSTSTACK 65536
+
+/* the ends of the data of the program, see end(3) */
+extern char etext, end;
+#else
+/* from the makefile */
+#define MEMPROF_STACKHIGH 0xD1A87E
+#define MEMPROF_STACKSIZE 4096
+#define MEMPROF_BSSLOW 0xD031F6
+#define MEMPROF_BSSHIGH 0xD13FD6
+
+extern uint8_t __heapbot[];
+#endif
+
+/* the painted ranges, stack and heap, 0 before memprofstart() */
+uintptr_t memprofstacklow, memprofstacktop;
+uintptr_t memprofheaplow, memprofheaptop;
+
+#ifdef HOST_BUILD
+/* paints the stack below the frame of memprofstart() */
+static void __attribute__((noinline)) memprofpaint(void) {
+    volatile uint8_t area[MEMPROF_HOSTSTACK];
+    size_t i;
+
+    for(i = 0; i < MEMPROF_HOSTSTACK; i++) {
+        area[i] = MEMPROF_PAINT;
+    }
+    memprofstacklow = (uintptr_t)area;
+    memprofstacktop = (uintptr_t)area + MEMPROF_HOSTSTACK;
+}
+#endif
+
+/**
+ * paints the stack below the caller and the free heap. called first
+ * thing, by main()
+ */
+void memprofstart(void) {
+#ifdef HOST_BUILD
+    memprofpaint();
+    /* brk grows the heap on demand, there is nothing to paint */
+    memprofheaplow = memprofheaptop = (uintptr_t)sbrk(0);
+#else
+    volatile uint8_t here;
+    volatile uint8_t *p;
+
+    /* up to a little below the frame of the caller, this one included */
+    memprofstacklow = MEMPROF_STACKHIGH - MEMPROF_STACKSIZE;
+    memprofstacktop = MEMPROF_STACKHIGH;
+    for(p = (volatile uint8_t *)memprofstacklow; p < &here - 32; p++) {
+        *p = MEMPROF_PAINT;
+    }
+    memprofheaplow = (uintptr_t)__heapbot;
+    memprofheaptop = MEMPROF_BSSHIGH;
+    for(p = (volatile uint8_t *)memprofheaplow; p < (volatile uint8_t *)memprofheaptop; p++) {
+        *p = MEMPROF_PAINT;
+    }
+#endif
+}
+
+/**
+ * writes the high-water marks since memprofstart(), after when. does
+ * nothing before memprofstart()
+ */
+void memprofreport(const char *when) {
+    volatile uint8_t *p;
+    uint32_t stack, heap;
+
+    if(memprofstacktop == 0) {
+        return;
+    }
+    /* the stack grows down, the heap up */
+    for(p = (volatile uint8_t *)memprofstacklow; p < (volatile uint8_t *)memprofstacktop && *p == MEMPROF_PAINT; p++);
+    stack = memprofstacktop - (uintptr_t)p;
+    for(p = (volatile uint8_t *)memprofheaptop; p > (volatile uint8_t *)memprofheaplow && p[-1] == MEMPROF_PAINT; p--);
+    heap = (uintptr_t)p - memprofheaplow;
+#ifdef HOST_BUILD
+    {
+        struct rusage usage;
+
+        heap = (uintptr_t)sbrk(0) - memprofheaplow;
+        getrusage(RUSAGE_SELF, &usage);
+        printf("memory %s stack %lu static %lu heap %lu maxrss %ldk\n", when, (unsigned long)stack,
+               (unsigned long)((uintptr_t)&end - (uintptr_t)&etext), (unsigned long)heap, usage.ru_maxrss);
+    }
+#else
+    dbg_printf("memory %s stack %lu/%lu static %lu heap %lu/%lu\n", when, (unsigned long)stack,
+               (unsigned long)MEMPROF_STACKSIZE, (unsigned long)(memprofheaplow - MEMPROF_BSSLOW),
+               (unsigned long)heap, (unsigned long)(memprofheaptop - memprofheaplow));
+#endif
+}
+
+#endif
@@ -0,0 +1,222 @@
+/**
+ * the parts of the engine that depend on the side to move, written once
+ * and compiled once per side. simplech.c includes this file twice, with
+ * SIDE defined as BLACK and as WHITE; SIDED(name) gives the functions of
+ * each copy their _black or _white suffix.
+ *
+ * with the side a constant, the compiler drops every color == BLACK test
+ * and folds the directions and promotion rows into the code.
+ */
+
+#if SIDE == BLACK
+#define SIDED(name) name##_black
+#define OTHER(name) name##_white
+#define ENEMY WHITE
+#define AHEAD 4                 /* square offsets of the two forward steps */
+#define AHEAD2 5
+#define FORWARD 0               /* neighbor direction of AHEAD, AHEAD2 is the next */
+#define PROMOTES(from) ((from) >= 32)
+#define LOST (-5000)
+#define EGDBWON EGDBWIN
+/* black maximizes */
+#define CUTOFF(value) ((value) >= beta)
+#define IMPROVES(value) ((value) > alpha)
+#define FRAMEBOUND(f) ((f)->alpha)    /* the bound a node raises, and its null window */
+#define FRAMEWINDOW(f) ((f)->alpha)
+#else
+#define SIDED(name) name##_white
+#define OTHER(name) name##_black
+#define ENEMY BLACK
+#define AHEAD (-4)
+#define AHEAD2 (-5)
+#define FORWARD 2
+#define PROMOTES(from) ((from) <= 13)
+#define LOST 5000
+#define EGDBWON (-EGDBWIN)
+/* white minimizes */
+#define CUTOFF(value) ((value) <= alpha)
+#define IMPROVES(value) ((value) < beta)
+#define FRAMEBOUND(f) ((f)->beta)
+#define FRAMEWINDOW(f) ((f)->beta - 1)
+#endif
+
+/* appends the single step of piece from square from to square to */
+#define ADDSTEP(from, to, piece, after) do { \
+        movelist[n].n = 2; \
+        movelist[n].m[0] = (FREE << 16) | ((piece) << 8) | (from); \
+        movelist[n].m[1] = ((after) << 16) | (FREE << 8) | (to); \
+        n++; \
+    } while(0)
+
+/**
+ * alphabeta, cut where it would recurse into the steps of
+ * searchframes(). enternode starts the node of frame f, up to its first
+ * move or its value
+ */
+int SIDED(enternode)(struct searchframe *f) {
+#ifdef HOST_BUILD
+    if(searchpoll != NULL && ++searchpolls == 0) {
+        searchpoll();
+    }
+#endif
+    if (*play || stopsearch) {
+        f->value = 0;
+        return(NODE_DONE);
+    }
+    if(nodelimit != 0 && ++nodecount >= nodelimit) {
+        stopsearch = 1;
+        f->value = 0;
+        return(NODE_DONE);
+    }
+    if(timelimit != 0 && ++polls == 0 && readclock() >= timelimit) {
+        stopsearch = 1;
+        f->value = 0;
+        return(NODE_DONE);
+    }
+    STAT(searchstats.nodes++);
+    STAT(if(ply > searchstats.seldepth) searchstats.seldepth = ply);
+    STAT(if(ply < MAXPV) pvlength[ply] = ply);
+
+    if(repetition()) {
+        f->value = 0;
+        return(NODE_DONE);
+    }
+
+#if EGDB
+    if(piececount <= egdbpieces) {
+        int result = egdbprobe(SIDE);
+        if(result != UNKNOWN) {
+            STAT(searchstats.egdbhits++);
+            f->value = result == DRAW ? 0 : (result == WIN ? EGDBWON : -EGDBWON) + evaluation(SIDE);
+            return(NODE_DONE);
+        }
+    }
+#endif
+
+    f->capture = SIDED(testcapture)();
+    if((f->depth == 0 && f->capture == 0) || ply == MAXPLY || arenatop > ARENASIZE - NODESLOTS) {
+        STAT(searchstats.leaves++);
+        f->value = cachedevaluation(SIDE);
+        return(NODE_DONE);
+    }
+    if(f->depth == 0) {
+        f->depth = 1;
+    }
+    f->bestmove = 0;
+    initpicker(&f->picker, SIDE, f->capture);
+    return(NODE_OPEN);
+}
+
+/**
+ * makes the next move of the node of frame f and sets up the node after
+ * it in the frame above, or ends the node when it has no moves left
+ */
+int SIDED(nextchild)(struct searchframe *f) {
+    struct searchframe *child = f + 1;
+    struct move2 *move;
+    int reduction = 0;
+
+    if((move = nextmove(&f->picker)) == NULL) {
+        if(f->picker.next == 0) {
+            f->value = LOST;
+            return(NODE_DONE);
+        }
+        if(f->bestmove != 0) {
+            ttable[hashkey & (TTSIZE - 1)].lock = hashkey >> 16;
+            ttable[hashkey & (TTSIZE - 1)].move = f->bestmove;
+        }
+        f->value = FRAMEBOUND(f);
+        return(NODE_DONE);
+    }
+    if(f->capture == 0 && f->picker.next > f->picker.ntried && !PROMOTION(move)) {
+        reduction = lmrtable[f->depth < LMRDEPTH ? f->depth : LMRDEPTH - 1]
+                            [f->picker.next <= LMRMOVES ? f->picker.next - 1 : LMRMOVES - 1];
+    }
+
+    domove(*move);
+    pushposition(move);
+    f->move = move;
+    f->reduced = reduction != 0;
+    child->color = ENEMY;
+    child->depth = f->depth - 1 - reduction;
+    if(reduction != 0) {
+        STAT(searchstats.reduced++);
+        child->alpha = FRAMEWINDOW(f);
+        child->beta = FRAMEWINDOW(f) + 1;
+    } else {
+        child->alpha = f->alpha;
+        child->beta = f->beta;
+    }
+    return(NODE_CHILD);
+}
+
+/**
+ * takes the value of the move of frame f: searches it again at full
+ * depth if a reduced search beat the window, else takes it back and
+ * ends the node on a cutoff. a stopped search just takes the moves back
+ */
+int SIDED(childdone)(struct searchframe *f, int value) {
+    struct move2 *move = f->move;
+    int alpha = f->alpha, beta = f->beta;
+
+    if(stopsearch || *play) {
+        /* value is the 0 of a node that was not searched: only unwind */
+        popposition();
+        undomove(*move);
+        f->value = 0;
+        return(NODE_DONE);
+    }
+    if(f->reduced) {
+        f->reduced = 0;
+        if(IMPROVES(value)) {
+            struct searchframe *child = f + 1;
+
+            STAT(searchstats.researched++);
+            child->color = ENEMY;
+            child->depth = f->depth - 1;
+            child->alpha = alpha;
+            child->beta = beta;
+            return(NODE_CHILD);
+        }
+    }
+
+    popposition();
+    undomove(*move);
+
+    if(CUTOFF(value)) {
+        STAT(searchstats.cutoffs++);
+        STAT(if(f->picker.next == 1) searchstats.firstcutoffs++);
+        STAT(if(f->picker.stage <= STAGE_QUIETS) searchstats.skipgen++);
+        storemove(move, f->capture);
+        f->value = value;
+        return(NODE_DONE);
+    }
+    if(IMPROVES(value)) {
+        FRAMEBOUND(f) = value;
+        f->bestmove = MOVECODE(move);
+        STAT(updatepv(move));
+    }
+    return(NODE_NEXT);
+}
+
+/* the move generation of the board backend */
+#if BOARD_BITBOARD
+#include "bitboard.h"
+#else
+#include "mailbox.h"
+#endif
+
+#undef SIDED
+#undef OTHER
+#undef ENEMY
+#undef AHEAD
+#undef AHEAD2
+#undef FORWARD
+#undef PROMOTES
+#undef LOST
+#undef EGDBWON
+#undef CUTOFF
+#undef IMPROVES
+#undef FRAMEBOUND
+#undef FRAMEWINDOW
+#undef ADDSTEP
@@ -71,51 +71,414 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
+#include <stdlib.h>
+#ifdef HOST_BUILD
+#include <time.h>
+#include "host.h"
+#else
 #include <debug.h>
 #include <tice.h>
-#include <stdlib.h>
+#include <lib/ce/fileioc.h>
+#endif
 
 /* definitions */
 #include "simplech.h"
 #define CHANGECOLOR 3
 #define MAXMOVES 51
+#define MAXPLY 64
+#define MAXGAMEPLY 128
+#define HASHSTACK (MAXGAMEPLY + MAXPLY)
+#define SEARCHDEPTH 6
+#define MAXANALYSIS 32
+
+/**
+ * move lists of the search are carved out of one static arena instead of
+ * the stack. a node needs NODESLOTS free slots to generate into and then
+ * keeps only the moves it generated, typically 2-10.
+ *
+ * with 35 byte moves on the ez80 a stack movelist cost 1785 bytes per ply,
+ * so the ~4k stack below STACK_HIGH ran out after 2 plies. the search
+ * itself does not recurse either: its nodes are the static frames of
+ * searchframes(), about 60 bytes a ply, so the stack it needs is the same
+ * at any depth and MAXPLY is only a matter of static memory. the arena
+ * itself peaks at about 60 slots for the depth 6 searches of tools/bench
+ * (see arenapeak in the search statistics); a node that would overflow it
+ * is evaluated as a leaf, like one at MAXPLY.
+ */
+#define ARENASIZE 256
+
+/* the quiet moves of a node plus the tt move and killers tried before them */
+#define NODESLOTS (MAXMOVES + 3)
+
+/**
+ * best move table, one from << 8 | to move per position. it only orders
+ * the moves, so an entry is checked for legality before it is played and
+ * the top half of the hash key is enough of a lock. 4 bytes an entry.
+ */
+#define TTSIZE 1024
+
+/**
+ * evaluation cache, direct mapped and indexed by the hash key like the
+ * best move table. positions with the other side to move hash apart, so
+ * the key covers everything evaluation() looks at. unlike a move, a
+ * wrong value can't be checked, so entries keep the whole key: with 16
+ * bits a depth 11 search already saw a few false hits. a power of two,
+ * 6 bytes an entry on the calc; 0 turns the cache off.
+ */
+#ifndef EVALCACHESIZE
+#define EVALCACHESIZE 512
+#endif
+
+/* captures a move2 has room for: the longest legal capture, a king's
+ * that takes 9 pieces. men take at most 3 before they reach the back row */
+#define MAXJUMPS 9
 
 /* structure definitions */
 struct move2 {
     short n;
-    int m[8];
+    int m[MAXJUMPS + 2];
 };
 
+struct ttentry {
+    uint16_t lock;
+    uint16_t move;
+};
+
+struct evalentry {
+    uint32_t key;
+    int16_t value;
+};
+
+/* stages of the move picker, in the order the moves are handed out */
+#define STAGE_TT 0
+#define STAGE_CAPTURES 1
+#define STAGE_KILLERS 2
+#define STAGE_QUIETS 3
+#define STAGE_DONE 4
+
+/**
+ * state of the moves of one search node. captures are compulsory, so a
+ * node gets either the captures or the killers and quiet moves.
+ */
+struct movepicker {
+    struct move2 *list; /* the node's arena slots */
+    int base;           /* ... and their index in the arena */
+    int n;              /* moves generated so far */
+    int next;           /* moves handed out so far */
+    uint16_t tried[3];  /* quiet moves handed out before STAGE_QUIETS */
+    uint8_t ntried;
+    uint8_t skip;       /* square whose captures the tt stage generated */
+    uint8_t stage;
+    uint8_t color;
+    uint8_t capture;
+};
+
+/**
+ * one node of the search stack of searchframes(), frames[ply] for the
+ * node at ply. the search keeps here what a recursive alphabeta would keep
+ * in its locals, so it can stop after any node and go on from there later.
+ */
+struct searchframe {
+    struct movepicker picker;
+    struct move2 *move; /* being searched */
+    int depth;
+    int alpha;
+    int beta;
+    int value;          /* of the node once it is done */
+    uint16_t bestmove;
+    uint8_t capture;
+    uint8_t color;
+    uint8_t reduced;    /* move is searched with a reduction first */
+};
+
+/* what a step of the search stack left to do next */
+#define NODE_DONE 0     /* the node has its value */
+#define NODE_OPEN 1     /* the node is ready for its first move */
+#define NODE_CHILD 2    /* a move is made and its node set up above */
+#define NODE_NEXT 3     /* the node goes on with its next move */
+
+/* from << 8 | to of a move, the squares are cboard squares */
+#define MOVECODE(move) ((uint16_t)((((move)->m[0] % 256) << 8) | ((move)->m[1] % 256)))
+
+/* a man moving to the last row */
+#define PROMOTION(move) ((((move)->m[0] >> 8) & MAN) && (((move)->m[1] >> 16) & KING))
+
+/**
+ * late move reductions: the plies taken off the null window search of a
+ * quiet move, by remaining depth and by the move's place in the node.
+ * both indices are clamped to the table. moves from the best move table,
+ * killers and promotions are never reduced, and a reduced move that
+ * beats the window is searched again at full depth. an entry may be at
+ * most depth - 1; all zeros turns the reductions off.
+ */
+#define LMRDEPTH 8
+#define LMRMOVES 8
+
 /* used to quickly exit */
-uint8_t exit_key;
+THREADLOCAL uint8_t exit_key;
 
 /* function prototypes  */
-void getmove(uint8_t cboard[8][8], uint8_t color, int *playnow);
-void movetonotation(struct move2 move);
+int  squarenumber(int square);
+void movetonotation(struct move2 move, char *str);
+void packmove(struct move2 *move, gamemove_t *out);
+void startclock(void);
+uint32_t readclock(void);
+#ifdef HOST_BUILD
+uint32_t monotonicms(void);
+#endif
+uint32_t hashboard(uint8_t b[8][8], uint8_t color);
+void setupboard(uint8_t inboard[8][8], uint8_t color);
+void initzobrist(void);
 
 /* search */
-int  checkers(uint8_t color);
+int  startsearch(uint8_t color);
+void startdepth(void);
+void enddepth(int value);
+int  enterroot(struct searchframe *f);
+int  nextroot(struct searchframe *f);
+int  rootdone(struct searchframe *f, int value);
+int  searchframes(int action, int base, uint32_t *nodes);
 int  alphabeta(int depth, int alpha, int beta, uint8_t color);
 int  firstalphabeta(int depth, int alpha, int beta, uint8_t color, struct move2 *best);
 void domove(struct move2 move);
 void undomove(struct move2 move);
+void pushposition(struct move2 *move);
+void popposition(void);
+int  repetition(void);
 int  evaluation(uint8_t color);
+int  cachedevaluation(uint8_t color);
+void storemove(struct move2 *move, int capture);
+void initpicker(struct movepicker *picker, uint8_t color, int capture);
+struct move2 *nextmove(struct movepicker *picker);
+int  stepmove(struct move2 *move, uint16_t code, uint8_t color);
+int  enternode_black(struct searchframe *f);
+int  enternode_white(struct searchframe *f);
+int  nextchild_black(struct searchframe *f);
+int  nextchild_white(struct searchframe *f);
+int  childdone_black(struct searchframe *f, int value);
+int  childdone_white(struct searchframe *f, int value);
 
 /* move generation */
 int  generatemovelist(struct move2 movelist[MAXMOVES], uint8_t color);
 int  generatecapturelist(struct move2 movelist[MAXMOVES], uint8_t color);
-void blackmancapture(int *n, struct move2 movelist[MAXMOVES], int square);
-void blackkingcapture(int *n, struct move2 movelist[MAXMOVES], int square);
-void whitemancapture(int *n, struct move2 movelist[MAXMOVES], int square);
-void whitekingcapture(int *n, struct move2 movelist[MAXMOVES], int square);
+void capturesequences(int *n, struct move2 movelist[MAXMOVES], int square);
 int  testcapture(uint8_t color);
+int  generatemovelist_black(struct move2 movelist[MAXMOVES]);
+int  generatemovelist_white(struct move2 movelist[MAXMOVES]);
+int  generatecapturelist_black(struct move2 movelist[MAXMOVES]);
+int  generatecapturelist_white(struct move2 movelist[MAXMOVES]);
+int  testcapture_black(void);
+int  testcapture_white(void);
+void loadboard(void);
+#if BOARD_BITBOARD
+uint32_t jumpers_black(void);
+uint32_t jumpers_white(void);
+#endif
 
 /* globals  */
 int value[17] = {0, 0, 0, 0, 0, 1, 256, 0, 0, 16, 4096, 0, 0, 0, 0, 0, 0};
-int *play;
-uint8_t cboard[46];
+THREADLOCAL int *play;
+THREADLOCAL uint8_t cboard[46];
+
+/* bit of each cboard square in a 32 bit square set, 0 off the board */
+#define SQBIT(square) ((uint32_t)1 << ((square) - 5 - (square) / 9))
+const uint32_t squarebit[46] = {
+    0, 0, 0, 0, 0, SQBIT(5), SQBIT(6), SQBIT(7),
+    SQBIT(8), 0, SQBIT(10), SQBIT(11), SQBIT(12), SQBIT(13), SQBIT(14), SQBIT(15),
+    SQBIT(16), SQBIT(17), 0, SQBIT(19), SQBIT(20), SQBIT(21), SQBIT(22), SQBIT(23),
+    SQBIT(24), SQBIT(25), SQBIT(26), 0, SQBIT(28), SQBIT(29), SQBIT(30), SQBIT(31),
+    SQBIT(32), SQBIT(33), SQBIT(34), SQBIT(35), 0, SQBIT(37), SQBIT(38), SQBIT(39),
+    SQBIT(40), 0, 0, 0, 0, 0
+};
 
-#include <debug.h>
+#if MOVEGEN_TABLES
+/**
+ * the squares around each cboard square, by direction +4, +5, -4 and -5,
+ * the order of the unrolled generators: black men move in the first two
+ * directions, white men in the last two. neighbor is the square one step
+ * away, the one jumped over in a capture, and landing the one a capture
+ * lands on. off the board both are 0, which is a border square, so
+ * cboard[0] stops a step or jump without a test of its own.
+ */
+#define ONBOARD(s) ((s) >= 5 && (s) <= 40 && (s) % 9 != 0)
+#define NEIGHBOR(s, step) (ONBOARD(s) && ONBOARD((s) + (step)) ? (s) + (step) : 0)
+#define LANDING(s, step) (NEIGHBOR(s, step) && ONBOARD((s) + 2 * (step)) ? (s) + 2 * (step) : 0)
+#define NEIGHBORS(s) {NEIGHBOR(s, 4), NEIGHBOR(s, 5), NEIGHBOR(s, -4), NEIGHBOR(s, -5)}
+#define LANDINGS(s) {LANDING(s, 4), LANDING(s, 5), LANDING(s, -4), LANDING(s, -5)}
+#define NINE(f, s) f(s), f(s + 1), f(s + 2), f(s + 3), f(s + 4), f(s + 5), f(s + 6), f(s + 7), f(s + 8)
+const uint8_t neighbor[46][4] = {
+    NINE(NEIGHBORS, 0), NINE(NEIGHBORS, 9), NINE(NEIGHBORS, 18), NINE(NEIGHBORS, 27),
+    NINE(NEIGHBORS, 36), NEIGHBORS(45)
+};
+const uint8_t landing[46][4] = {
+    NINE(LANDINGS, 0), NINE(LANDINGS, 9), NINE(LANDINGS, 18), NINE(LANDINGS, 27),
+    NINE(LANDINGS, 36), LANDINGS(45)
+};
+#undef NINE
+#undef LANDINGS
+#undef NEIGHBORS
+#undef LANDING
+#undef NEIGHBOR
+#undef ONBOARD
+#endif
+
+#if BOARD_BITBOARD
+/**
+ * the bitboard backend keeps the pieces as 32 bit square sets next to
+ * cboard, which the evaluation and capturesequences still read. bit i
+ * is SQ_INDEX square i, as in squarebit.
+ */
+THREADLOCAL uint32_t pieces[3]; /* by color, pieces[BLACK] and pieces[WHITE] */
+THREADLOCAL uint32_t kings;
+#define TOGGLEPIECE(square, piece) do { \
+        if( ((piece) & (BLACK | WHITE)) != 0 ) { \
+            pieces[(piece) & (BLACK | WHITE)] ^= squarebit[square]; \
+            if( ((piece) & KING) != 0 ) { \
+                kings ^= squarebit[square]; \
+            } \
+        } \
+    } while(0)
+
+/* the squares one cboard step of +4, +5, -4 or -5 away from the squares */
+/* in b. even and odd rows shift by different amounts, the masks keep the */
+/* squares whose step stays on the board */
+#define STEP4(b)  ((((b) & 0x0E0E0E0EUL) << 3) | (((b) & 0x00F0F0F0UL) << 4))
+#define STEP5(b)  ((((b) & 0x0F0F0F0FUL) << 4) | (((b) & 0x00707070UL) << 5))
+#define STEPM4(b) ((((b) & 0x0F0F0F00UL) >> 4) | (((b) & 0x70707070UL) >> 3))
+#define STEPM5(b) ((((b) & 0x0E0E0E00UL) >> 5) | (((b) & 0xF0F0F0F0UL) >> 4))
+#endif
+
+/* zobrist keys per square and piece, indexed by PIECEKEY */
+uint32_t zobrist[46][4];
+uint32_t zobristside;
+THREADLOCAL uint32_t hashkey;
+#define PIECEKEY(square, piece) \
+    (((piece) & (BLACK | WHITE)) ? zobrist[square][(((piece) & KING) >> 2) | ((piece) & WHITE)] : 0)
+
+/* position history of the game and the current search line */
+/* quiet[i] counts the plies since the last capture or man move */
+THREADLOCAL uint32_t hashstack[HASHSTACK];
+THREADLOCAL uint8_t quiet[HASHSTACK];
+THREADLOCAL int hashtop;
+int drawplies = 80;
+
+/* distance from the root of the search */
+THREADLOCAL int ply;
+
+/* nominal depth of the search, in plies */
+int searchdepth = SEARCHDEPTH;
+
+/* a timed search stops once readclock() reaches timelimit, 0 for none */
+THREADLOCAL uint32_t timelimit;
+THREADLOCAL uint8_t polls;
+
+#ifdef HOST_BUILD
+/* called by the search every 256 nodes when set, so a host tool can stop */
+/* it or change its limits from the search's own thread */
+THREADLOCAL void (*searchpoll)(void);
+THREADLOCAL uint8_t searchpolls;
+#endif
+
+/* getmove deepens until it has visited nodebudget nodes, 0 for a fixed */
+/* depth search. a search stops once nodecount reaches nodelimit, 0 for */
+/* none; running out of nodes or time sets stopsearch */
+uint32_t nodebudget;
+THREADLOCAL uint32_t nodelimit;
+THREADLOCAL uint32_t nodecount;
+THREADLOCAL uint8_t stopsearch;
+
+/* 1 to search a position with a single legal move too, for its score, */
+/* instead of playing the move at once */
+int searchforced;
+
+/* the search stack, and the state of the search on it between two */
+/* calls of searchrun() */
+THREADLOCAL struct searchframe frames[MAXPLY + 1];
+THREADLOCAL struct {
+    struct move2 played;  /* best move of the last completed depth */
+    struct move2 best;    /* ... and so far of the depth being searched */
+    int eval;             /* score of played */
+    int depth;            /* being searched, the last completed once done */
+    uint8_t color;
+    uint8_t state;
+    uint8_t budget;       /* deepens until nodebudget runs out */
+    uint8_t searched;     /* played did not come without a search */
+} searchtask;
+
+/* leaves are off by up to evalnoise, by an amount that only depends on */
+/* the position, so weaker levels still play the same game every time */
+int evalnoise;
+
+/* node budget and evaluation noise of each difficulty level */
+const struct {
+    uint32_t nodes;
+    int noise;
+} levels[LEVELS] = {
+    {   300, 60 },
+    {  1500, 20 },
+    {  6000,  0 },
+    { 30000,  0 },
+};
+
+/* move lists of the search, arenatop is the first free slot */
+THREADLOCAL struct move2 movearena[ARENASIZE];
+THREADLOCAL int arenatop;
+
+/* move ordering: best moves by position, quiet moves that failed high by ply */
+THREADLOCAL struct ttentry ttable[TTSIZE];
+THREADLOCAL uint16_t killers[MAXPLY][2];
+
+#if EVALCACHESIZE
+THREADLOCAL struct evalentry evalcache[EVALCACHESIZE];
+#endif
+
+uint8_t lmrtable[LMRDEPTH][LMRMOVES] = {
+    {0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 1, 1, 1, 1},
+    {0, 0, 0, 0, 1, 1, 1, 1},
+    {0, 0, 0, 0, 1, 1, 1, 1},
+    {0, 0, 0, 0, 1, 1, 1, 1},
+};
+
+#if EGDB
+#include "egdb.h"
+
+/* pieces on cboard, to know when the databases have the position */
+THREADLOCAL int piececount;
+
+/* score of a database win: below a won search, above any evaluation */
+#define EGDBWIN 4000
+
+int  egdbprobe(uint8_t color);
+#endif
+
+#if BOOK
+#include "book.h"
+#endif
+
+#if MEMORY_PROFILE
+#include "memprof.h"
+#endif
+
+#if SEARCH_STATS
+#define STAT(x) x
+THREADLOCAL searchstats_t searchstats;
+
+/* triangular principal variation table, moves are from << 8 | to, with
+ * PVCAPTURE set in the low byte for captures: a king's double jump can
+ * end as close to its start as a single step */
+#define PVSQUARE 0x7F
+#define PVCAPTURE 0x80
+THREADLOCAL uint16_t pvtable[MAXPV][MAXPV];
+THREADLOCAL uint8_t pvlength[MAXPV + 1];
+void updatepv(struct move2 *move);
+void savepv(void);
+#else
+#define STAT(x)
+#endif
 
 /**
  * getmove is what checkeriboard calls. you get 6 parameters:
@@ -135,9 +498,223 @@ uint8_t cboard[46];
  * interrupting your search IMMEDIATELY.
  */
 
-void getmove(uint8_t inboard[8][8], uint8_t color, int *playnow) {
+uint8_t getmove(uint8_t inboard[8][8], uint8_t color, int *playnow, gamemove_t *played) {
+    if(!searchstart(inboard, color, playnow)) {
+        return 0;
+    }
+    searchrun(0);
+    return(searchresult(inboard, played));
+}
+
+/**
+ * getmove in parts, for a caller that has more to do while the engine
+ * thinks: searchstart() sets up the search of the move of color on b,
+ * searchrun() searches a slice of it at a time and searchresult() plays
+ * the move found on b. returns 0 if there is no legal move
+ */
+uint8_t searchstart(uint8_t inboard[8][8], uint8_t color, int *playnow) {
+    setupboard(inboard, color);
+    play = playnow;
+    ply = 0;
+    return(startsearch(color));
+}
+
+/**
+ * the depths a running search completed and the best move of the last
+ * one, in best, if there is one; how much of the node budget it spent,
+ * in percent, in spent
+ */
+uint8_t searchinfo(gamemove_t *best, uint8_t *spent) {
+    uint8_t depth = searchtask.depth - 1;
+
+    if(searchtask.state != SEARCH_RUNNING) {
+        depth = searchtask.depth;
+    }
+    if(depth != 0) {
+        packmove(&searchtask.played, best);
+    }
+    *spent = searchtask.budget && nodebudget != 0 ? (uint8_t)((uint64_t)nodecount * 100 / nodebudget) : 0;
+    return(depth);
+}
+
+/**
+ * plays the move of a search that is done on inboard and in played.
+ * returns 0 if there is none, or the search was interrupted by *playnow
+ */
+uint8_t searchresult(uint8_t inboard[8][8], gamemove_t *played) {
+    if(searchtask.state == SEARCH_NOMOVE) {
+        return 0;
+    }
+    if(searchtask.searched) {
+        if(*play) {
+            return 0;
+        }
+#if SEARCH_STATS
+        searchstats.depth = searchtask.depth;
+        searchstats.time = readclock();
+        searchstats.score = searchtask.eval;
+#ifndef HOST_BUILD
+        printstats();
+#endif
+#endif
+    }
+#if MEMORY_PROFILE
+    memprofreport("getmove");
+#endif
+    domove(searchtask.played);
+    packmove(&searchtask.played, played);
+
+    /* return the iboard */
+    inboard[0][0] = cboard[5];
+    inboard[2][0] = cboard[6];
+    inboard[4][0] = cboard[7];
+    inboard[6][0] = cboard[8];
+    inboard[1][1] = cboard[10];
+    inboard[3][1] = cboard[11];
+    inboard[5][1] = cboard[12];
+    inboard[7][1] = cboard[13];
+    inboard[0][2] = cboard[14];
+    inboard[2][2] = cboard[15];
+    inboard[4][2] = cboard[16];
+    inboard[6][2] = cboard[17];
+    inboard[1][3] = cboard[19];
+    inboard[3][3] = cboard[20];
+    inboard[5][3] = cboard[21];
+    inboard[7][3] = cboard[22];
+    inboard[0][4] = cboard[23];
+    inboard[2][4] = cboard[24];
+    inboard[4][4] = cboard[25];
+    inboard[6][4] = cboard[26];
+    inboard[1][5] = cboard[28];
+    inboard[3][5] = cboard[29];
+    inboard[5][5] = cboard[30];
+    inboard[7][5] = cboard[31];
+    inboard[0][6] = cboard[32];
+    inboard[2][6] = cboard[33];
+    inboard[4][6] = cboard[34];
+    inboard[6][6] = cboard[35];
+    inboard[1][7] = cboard[37];
+    inboard[3][7] = cboard[38];
+    inboard[5][7] = cboard[39];
+    inboard[7][7] = cboard[40];
+    return 1;
+}
+
+/**
+ * multi-pv analysis for hints and analysis tools. every move of color on
+ * b is searched with a full window, one depth after the other until ms
+ * milliseconds have passed, and result gets the best k (at most
+ * MAXHINTS) of the last completed depth. the first depth always
+ * completes. a result that already holds this position is returned as
+ * it is, so repeated calls are free. returns the number of moves in
+ * result.
+ */
+uint8_t analyze(uint8_t b[8][8], uint8_t color, uint8_t k, uint32_t ms, analysis_t *result) {
+    static int noplay; /* only the clock stops an analysis */
+    struct move2 *movelist = movearena;
+    int scores[MAXMOVES];
+    int numberofmoves;
+    int depth, i, j;
+    int noise = evalnoise;
+
+    if(k > MAXHINTS) {
+        k = MAXHINTS;
+    }
+    setupboard(b, color);
+    if(result->hash == hashkey && result->depth != 0 && (result->count >= k || result->count == result->legal)) {
+        return(result->count);
+    }
+
+    numberofmoves = generatecapturelist(movelist, color);
+    if(numberofmoves == 0) {
+        numberofmoves = generatemovelist(movelist, color);
+    }
+    result->hash = hashkey;
+    result->legal = numberofmoves;
+    result->count = 0;
+    result->depth = 0;
+
+    /* hints are always at full strength */
+    stopsearch = 0;
+    evalnoise = 0;
+    play = &noplay;
+    ply = 0;
+    memset(killers, 0, sizeof(killers));
+    startclock();
+    for(depth = 1; depth <= MAXANALYSIS && numberofmoves != 0; depth++) {
+        timelimit = depth > 1 ? ms : 0;
+        for(i = 0; i < numberofmoves; i++) {
+            arenatop = numberofmoves;
+            domove(movelist[i]);
+            pushposition(&movelist[i]);
+            scores[i] = alphabeta(depth - 1, -10000, 10000, color ^ CHANGECOLOR);
+            popposition();
+            undomove(movelist[i]);
+            if(stopsearch) {
+                break;
+            }
+            if(color == WHITE) {
+                scores[i] = -scores[i];
+            }
+        }
+        if(stopsearch) {
+            break;
+        }
+
+        /* best first, which is also the move order of the next depth */
+        for(i = 1; i < numberofmoves; i++) {
+            struct move2 move = movelist[i];
+            int score = scores[i];
+            for(j = i; j > 0 && scores[j - 1] < score; j--) {
+                movelist[j] = movelist[j - 1];
+                scores[j] = scores[j - 1];
+            }
+            movelist[j] = move;
+            scores[j] = score;
+        }
+        result->depth = depth;
+        result->count = numberofmoves < k ? numberofmoves : k;
+        for(i = 0; i < result->count; i++) {
+            packmove(&movelist[i], &result->move[i]);
+            result->score[i] = scores[i];
+        }
+        if(readclock() >= ms) {
+            break;
+        }
+    }
+    timelimit = 0;
+    evalnoise = noise;
+
+    return(result->count);
+}
+
+/**
+ * purpose: getmove searches with the node budget and evaluation noise of
+ * level from now on
+ */
+void setlevel(uint8_t level) {
+    nodebudget = levels[level].nodes;
+    evalnoise = levels[level].noise;
+}
+
+/**
+ * forgets the transposition table, killers and evaluation cache earlier
+ * searches left behind, so the next search only depends on its position
+ */
+void searchreset(void) {
+    memset(ttable, 0, sizeof(ttable));
+    memset(killers, 0, sizeof(killers));
+#if EVALCACHESIZE
+    memset(evalcache, 0, sizeof(evalcache));
+#endif
+}
+
+/**
+ * loads the position of inboard with color to move into the engine
+ */
+void setupboard(uint8_t inboard[8][8], uint8_t color) {
     uint8_t i;
-    
+
     /* initialize iboard */
     for(i = 0; i < 46; i++) {
         cboard[i] = OCCUPIED;
@@ -186,270 +763,1084 @@ void getmove(uint8_t inboard[8][8], uint8_t color, int *playnow) {
     for(i = 9; i <= 36; i += 9) {
         cboard[i] = OCCUPIED;
     }
+    loadboard();
+
+    /* the game history only applies if it was set up for this position */
+    hashkey = hashboard(inboard, color);
+    if(hashstack[hashtop] != hashkey) {
+        hashtop = 0;
+        hashstack[0] = hashkey;
+        quiet[0] = 0;
+    }
+}
 
-    play = playnow;
-    checkers(color);
-    
-    /* return the iboard */
-    inboard[0][0] = cboard[5];
-    inboard[2][0] = cboard[6];
-    inboard[4][0] = cboard[7];
-    inboard[6][0] = cboard[8];
-    inboard[1][1] = cboard[10];
-    inboard[3][1] = cboard[11];
-    inboard[5][1] = cboard[12];
-    inboard[7][1] = cboard[13];
-    inboard[0][2] = cboard[14];
-    inboard[2][2] = cboard[15];
-    inboard[4][2] = cboard[16];
-    inboard[6][2] = cboard[17];
-    inboard[1][3] = cboard[19];
-    inboard[3][3] = cboard[20];
-    inboard[5][3] = cboard[21];
-    inboard[7][3] = cboard[22];
-    inboard[0][4] = cboard[23];
-    inboard[2][4] = cboard[24];
-    inboard[4][4] = cboard[25];
-    inboard[6][4] = cboard[26];
-    inboard[1][5] = cboard[28];
-    inboard[3][5] = cboard[29];
-    inboard[5][5] = cboard[30];
-    inboard[7][5] = cboard[31];
-    inboard[0][6] = cboard[32];
-    inboard[2][6] = cboard[33];
-    inboard[4][6] = cboard[34];
-    inboard[6][6] = cboard[35];
-    inboard[1][7] = cboard[37];
-    inboard[3][7] = cboard[38];
-    inboard[5][7] = cboard[39];
-    inboard[7][7] = cboard[40];
+/**
+ * fills the zobrist keys from a fixed xorshift sequence
+ */
+void initzobrist(void) {
+    uint32_t x = 2463534242UL;
+    int i, j;
+
+    for(i = 0; i < 46; i++) {
+        for(j = 0; j < 4; j++) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            zobrist[i][j] = x;
+        }
+    }
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    zobristside = x;
 }
 
+/**
+ * hash key of an 8x8 board, matching the key domove keeps for cboard
+ */
+uint32_t hashboard(uint8_t b[8][8], uint8_t color) {
+    uint32_t key;
+    uint8_t i;
 
-void movetonotation(struct move2 move) {
-    int j, from, to;
+    if(!zobristside) {
+        initzobrist();
+    }
+    key = (color == WHITE) ? zobristside : 0;
+    for(i = 0; i < 32; i++) {
+        key ^= PIECEKEY(i + 5 + (i + 4) / 8, b[SQ_COL(i)][SQ_ROW(i)]);
+    }
+    return key;
+}
 
-    from = move.m[0] % 256;
-    to = move.m[1] % 256;
-    from = from - (from / 9);
-    to = to - (to / 9);
-    from -= 5;
-    to -= 5;
-    j = from % 4;
-    from -= j;
-    j = 3 - j;
-    from += j;
-    j = to % 4;
-    to -= j;
+/**
+ * loads the positions since the last capture or man move of the game, so
+ * the search can see repetitions. b is the current position, moves the
+ * plies that led to it.
+ * returns DRAW if the game is drawn by repetition or by the drawplies
+ * rule, UNKNOWN otherwise.
+ */
+uint8_t setgamehistory(uint8_t b[8][8], uint8_t color, const gamemove_t *moves, uint16_t n) {
+    uint8_t tmp[8][8];
+    int i, plies = 0, seen = 0;
+
+    memcpy(tmp, b, sizeof(tmp));
+    hashstack[MAXGAMEPLY - 1] = hashboard(tmp, color);
+    while(n && plies < MAXGAMEPLY - 1) {
+        const gamemove_t *move = &moves[--n];
+        if(move->captured || !(move->piece & KING)) {
+            break;
+        }
+        unmakegamemove(tmp, move);
+        color ^= CHANGECOLOR;
+        plies++;
+        hashstack[MAXGAMEPLY - 1 - plies] = hashboard(tmp, color);
+    }
+
+    /* move the line to the bottom of the stack, oldest first */
+    memmove(hashstack, &hashstack[MAXGAMEPLY - 1 - plies], (plies + 1) * sizeof(uint32_t));
+    for(i = 0; i <= plies; i++) {
+        quiet[i] = i;
+    }
+    hashtop = plies;
+
+    for(i = hashtop - 2; i >= 0; i -= 2) {
+        if(hashstack[i] == hashstack[hashtop]) {
+            seen++;
+        }
+    }
+    if(seen >= 2 || plies >= drawplies) {
+        return DRAW;
+    }
+    return UNKNOWN;
+}
+
+/**
+ * converts an engine move into the compact history format
+ */
+void packmove(struct move2 *move, gamemove_t *out) {
+    int i;
+
+    out->from = (move->m[0] % 256) - 5 - (move->m[0] % 256) / 9;
+    out->to = (move->m[1] % 256) - 5 - (move->m[1] % 256) / 9;
+    out->piece = (move->m[0] >> 8) % 256;
+    out->after = (move->m[1] >> 16) % 256;
+    out->captured = 0;
+    out->capkings = 0;
+    for(i = 2; i < move->n; i++) {
+        int square = move->m[i] % 256;
+        uint32_t bit = (uint32_t)1 << (square - 5 - square / 9);
+        out->captured |= bit;
+        if(((move->m[i] >> 8) % 256) & KING) {
+            out->capkings |= bit;
+        }
+    }
+}
+
+/**
+ * plays a history move on an 8x8 board, the counterpart of domove
+ */
+void makegamemove(uint8_t b[8][8], const gamemove_t *move) {
+    uint8_t i;
+    uint32_t bits;
+
+    b[SQ_COL(move->from)][SQ_ROW(move->from)] = FREE;
+    for(i = 0, bits = move->captured; bits; i++, bits >>= 1) {
+        if(bits & 1) {
+            b[SQ_COL(i)][SQ_ROW(i)] = FREE;
+        }
+    }
+    b[SQ_COL(move->to)][SQ_ROW(move->to)] = move->after;
+}
+
+/**
+ * takes back a history move on an 8x8 board, the counterpart of undomove
+ */
+void unmakegamemove(uint8_t b[8][8], const gamemove_t *move) {
+    uint8_t i;
+    uint8_t enemy = (move->piece & (BLACK | WHITE)) ^ CHANGECOLOR;
+    uint32_t bits;
+
+    b[SQ_COL(move->to)][SQ_ROW(move->to)] = FREE;
+    for(i = 0, bits = move->captured; bits; i++, bits >>= 1) {
+        if(bits & 1) {
+            b[SQ_COL(i)][SQ_ROW(i)] = enemy | ((move->capkings >> i) & 1 ? KING : MAN);
+        }
+    }
+    b[SQ_COL(move->from)][SQ_ROW(move->from)] = move->piece;
+}
+
+
+/**
+ * reads a position in checkers fen, the side to move and the squares
+ * of each color in 1..32 notation, e.g. "B:W18,24,K10:B12,16,K22" or
+ * "B:W21-32:B1-12". K marks a king, a range stands for men on all its
+ * squares. b and color are only changed if fen is a position.
+ * returns 1 if it is, 0 otherwise
+ */
+uint8_t fentoboard(const char *fen, uint8_t b[8][8], uint8_t *color) {
+    uint8_t tmp[8][8];
+    uint8_t side;
+
+    memset(tmp, 0, sizeof(tmp));
+    while(*fen == ' ' || *fen == '"') {
+        fen++;
+    }
+    if(*fen != 'B' && *fen != 'W') {
+        return 0;
+    }
+    side = *fen++ == 'B' ? BLACK : WHITE;
+    while(*fen == ':') {
+        uint8_t list;
+
+        fen++;
+        if(*fen != 'B' && *fen != 'W') {
+            return 0;
+        }
+        list = *fen++ == 'B' ? BLACK : WHITE;
+        while((*fen >= '0' && *fen <= '9') || *fen == 'K') {
+            uint8_t piece = list | MAN;
+            int first = 0, last, n;
+
+            if(*fen == 'K') {
+                piece = list | KING;
+                fen++;
+            }
+            while(*fen >= '0' && *fen <= '9' && first <= 32) {
+                first = first * 10 + *fen++ - '0';
+            }
+            last = first;
+            if(*fen == '-' && (piece & MAN)) {
+                last = 0;
+                fen++;
+                while(*fen >= '0' && *fen <= '9' && last <= 32) {
+                    last = last * 10 + *fen++ - '0';
+                }
+            }
+            if(first < 1 || last > 32 || last < first) {
+                return 0;
+            }
+            for(n = first; n <= last; n++) {
+                uint8_t i = SQ_FROMNUMBER(n);
+
+                /* a man on the row it promotes on would already be a king */
+                if(tmp[SQ_COL(i)][SQ_ROW(i)] != 0 ||
+                   (piece == (BLACK | MAN) && SQ_ROW(i) == 7) || (piece == (WHITE | MAN) && SQ_ROW(i) == 0)) {
+                    return 0;
+                }
+                tmp[SQ_COL(i)][SQ_ROW(i)] = piece;
+            }
+            if(*fen == ',') {
+                fen++;
+            }
+        }
+    }
+    while(*fen == ' ' || *fen == '"' || *fen == '.') {
+        fen++;
+    }
+    if(*fen != '\0' && *fen != '\n' && *fen != '\r') {
+        return 0;
+    }
+
+    memcpy(b, tmp, sizeof(tmp));
+    *color = side;
+    return 1;
+}
+
+/**
+ * writes b with color to move to str in checkers fen, white pieces
+ * first, each list in square order. str needs FENLENGTH bytes
+ */
+void boardtofen(uint8_t b[8][8], uint8_t color, char *str) {
+    uint8_t list, n;
+
+    *str++ = color == BLACK ? 'B' : 'W';
+    for(list = WHITE; list <= BLACK; list++) {
+        uint8_t listed = 0;
+
+        *str++ = ':';
+        *str++ = list == BLACK ? 'B' : 'W';
+        for(n = 1; n <= 32; n++) {
+            uint8_t i = SQ_FROMNUMBER(n);
+            uint8_t piece = b[SQ_COL(i)][SQ_ROW(i)];
+
+            if(!(piece & list)) {
+                continue;
+            }
+            if(listed++) {
+                *str++ = ',';
+            }
+            if(piece & KING) {
+                *str++ = 'K';
+            }
+            if(n >= 10) {
+                *str++ = '0' + n / 10;
+            }
+            *str++ = '0' + n % 10;
+        }
+    }
+    *str = '\0';
+}
+
+/**
+ * converts a cboard square to the standard 1..32 checkers notation
+ */
+int squarenumber(int square) {
+    int j;
+
+    square = square - (square / 9);
+    square -= 5;
+    j = square % 4;
+    square -= j;
     j = 3 - j;
-    to += j;
-    from++;
-    to++;
+    square += j;
+    return square + 1;
+}
+
+/**
+ * writes the move in standard notation, e.g. "11-15" or "15x24", to str
+ */
+void movetonotation(struct move2 move, char *str) {
+    sprintf(str, "%i%c%i", squarenumber(move.m[0] % 256), move.n > 2 ? 'x' : '-', squarenumber(move.m[1] % 256));
+}
+
+/**
+ * writes "x" and the squares a capture from square lands on until it
+ * ends on to, having jumped exactly the squares in left, to str. returns
+ * 0 if there is no such path
+ */
+static int capturepath(int square, int to, uint32_t left, char *str) {
+    int dx, dy;
+
+    if(left == 0) {
+        return(square == to);
+    }
+    for(dy = -1; dy <= 1; dy += 2) {
+        for(dx = -1; dx <= 1; dx += 2) {
+            int x = SQ_COL(square) + 2 * dx, y = SQ_ROW(square) + 2 * dy;
+            uint32_t over;
+
+            if(x < 0 || x > 7 || y < 0 || y > 7) {
+                continue;
+            }
+            over = (uint32_t)1 << SQ_INDEX(SQ_COL(square) + dx, SQ_ROW(square) + dy);
+            if((left & over) &&
+               capturepath(SQ_INDEX(x, y), to, left & ~over, str + sprintf(str, "x%i", SQ_NUMBER(SQ_INDEX(x, y))))) {
+                return(1);
+            }
+        }
+    }
+    *str = '\0';
+    return(0);
+}
+
+/**
+ * writes a history move in standard notation to str, a capture with
+ * every square it lands on, "9x18x27", so that two captures between the
+ * same squares read differently. str needs MOVELENGTH bytes
+ */
+void gamemovetonotation(const gamemove_t *move, char *str) {
+    str += sprintf(str, "%i", SQ_NUMBER(move->from));
+    if(move->captured == 0 || !capturepath(move->from, move->to, move->captured, str)) {
+        sprintf(str, "%c%i", move->captured ? 'x' : '-', SQ_NUMBER(move->to));
+    }
+}
+
+#ifdef HOST_BUILD
+THREADLOCAL uint32_t clockstart;
+
+/**
+ * milliseconds on the monotonic clock
+ */
+uint32_t monotonicms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void startclock(void) {
+    clockstart = monotonicms();
+}
+
+/**
+ * milliseconds since startclock
+ */
+uint32_t readclock(void) {
+    return monotonicms() - clockstart;
+}
+#else
+/**
+ * restarts timer 1 counting up on the 32768 Hz crystal
+ */
+void startclock(void) {
+    timer_Control = TIMER1_DISABLE;
+    timer_1_Counter = 0;
+    timer_Control = TIMER1_ENABLE | TIMER1_32K | TIMER1_UP;
+}
+
+/**
+ * milliseconds since startclock
+ */
+uint32_t readclock(void) {
+    return (timer_1_Counter * 125) >> 12;
+}
+#endif
+
+#if SEARCH_STATS
+/**
+ * keeps the principal variation of the last completed search in searchstats
+ */
+void savepv(void) {
+    int i;
+
+    searchstats.pvlength = pvlength[0];
+    for(i = 0; i < pvlength[0]; i++) {
+        searchstats.pv[i][0] = squarenumber(pvtable[0][i] >> 8);
+        searchstats.pv[i][1] = squarenumber(pvtable[0][i] & PVSQUARE);
+        searchstats.pv[i][2] = (pvtable[0][i] & PVCAPTURE) != 0;
+    }
+}
+
+/**
+ * writes the i-th move of the principal variation of the last search in
+ * standard notation to str, like movetonotation()
+ */
+void pvtonotation(int i, char *str) {
+    sprintf(str, "%i%c%i", searchstats.pv[i][0], searchstats.pv[i][2] ? 'x' : '-', searchstats.pv[i][1]);
+}
+
+/**
+ * makes move followed by the child's principal variation the pv of this ply
+ */
+void updatepv(struct move2 *move) {
+    int i;
+
+    if(ply >= MAXPV) {
+        return;
+    }
+    pvtable[ply][ply] = ((move->m[0] % 256) << 8) | (move->m[1] % 256) | (move->n > 2 ? PVCAPTURE : 0);
+    for(i = ply + 1; i < pvlength[ply + 1]; i++) {
+        pvtable[ply][i] = pvtable[ply + 1][i];
+    }
+    pvlength[ply] = pvlength[ply + 1] > ply + 1 ? pvlength[ply + 1] : ply + 1;
+}
+
+/**
+ * reports the statistics of the last search, through dbg_printf on the
+ * calc and as a single machine readable line on stdout on host builds
+ */
+void printstats(void) {
+    char pv[MAXPV * 6 + 1];
+    char *str = pv;
+    int i;
+    uint32_t interior = searchstats.nodes - searchstats.leaves;
+
+    *str = 0;
+    for(i = 0; i < searchstats.pvlength; i++) {
+        if(i) {
+            *str++ = ' ';
+        }
+        pvtonotation(i, str);
+        str += strlen(str);
+    }
+
+#ifdef HOST_BUILD
+    printf("stats depth %d seldepth %d nodes %lu leaves %lu cutoffs %lu firstcutoffs %lu"
+           " cutrate %lu firstcutrate %lu skipgen %lu skiprate %lu tthits %lu killerhits %lu"
+           " reduced %lu researched %lu evalhits %lu evalhitrate %lu egdbhits %lu"
+           " time %lu nps %lu arenapeak %d score %d pv %s\n",
+#else
+    dbg_printf("depth %d/%d nodes %lu leaves %lu cutoffs %lu first %lu"
+               " cut %lu%% first %lu%% skipgen %lu (%lu%%) tt %lu killers %lu"
+               " lmr %lu/%lu evalcache %lu (%lu%%) egdb %lu"
+               " %lums %lunps arena %d score %d pv %s\n",
+#endif
+        searchstats.depth, searchstats.seldepth,
+        (unsigned long)searchstats.nodes, (unsigned long)searchstats.leaves,
+        (unsigned long)searchstats.cutoffs, (unsigned long)searchstats.firstcutoffs,
+        (unsigned long)(interior ? searchstats.cutoffs * 100 / interior : 0),
+        (unsigned long)(searchstats.cutoffs ? searchstats.firstcutoffs * 100 / searchstats.cutoffs : 0),
+        (unsigned long)searchstats.skipgen,
+        (unsigned long)(interior ? searchstats.skipgen * 100 / interior : 0),
+        (unsigned long)searchstats.tthits, (unsigned long)searchstats.killerhits,
+        (unsigned long)searchstats.reduced, (unsigned long)searchstats.researched,
+        (unsigned long)searchstats.evalhits,
+        (unsigned long)(searchstats.leaves ? searchstats.evalhits * 100 / searchstats.leaves : 0),
+        (unsigned long)searchstats.egdbhits,
+        (unsigned long)searchstats.time,
+        (unsigned long)(searchstats.time ? searchstats.nodes * 1000 / searchstats.time : 0),
+        searchstats.arenapeak, searchstats.score, pv);
+}
+#endif
+
+/**
+ * purpose: a search for the move of color on the position set up by
+ * getmove() or searchstart(), to searchdepth or as deep as nodebudget
+ * allows. forced moves, unless searchforced, and book moves are played
+ * without a search, the rest starts the first depth on the search stack,
+ * which searchrun() then works through. returns 0 if there is no legal
+ * move
+ */
+int startsearch(uint8_t color) {
+    struct move2 *movelist = movearena;
+    int numberofmoves;
+
+#if SEARCH_STATS
+    memset(&searchstats, 0, sizeof(searchstats_t));
+#endif
+    searchtask.state = SEARCH_DONE;
+    searchtask.searched = 0;
+    searchtask.budget = 0;
+    searchtask.depth = 0;
+
+    /* check if there is only one move */
+    numberofmoves = generatecapturelist(movelist, color);
+    if(numberofmoves == 0) {
+        numberofmoves = generatemovelist(movelist, color);
+    }
+    if(numberofmoves == 0) {
+        searchtask.state = SEARCH_NOMOVE;
+        return(0); /* no legal moves */
+    }
+    /* the first move is played if nothing beats the window */
+    searchtask.played = movelist[0];
+    if(numberofmoves == 1 && !searchforced) {
+        return(1); /* forced capture or only one move */
+    }
+#if BOOK
+    if(bookentries != 0 && bookmove(movelist, numberofmoves, &searchtask.played)) {
+        return(1); /* book move */
+    }
+#endif
+
+    arenatop = 0;
+    stopsearch = 0;
+    startclock();
+    searchtask.color = color;
+    searchtask.eval = 0;
+    searchtask.searched = 1;
+    searchtask.budget = nodebudget != 0;
+    if(searchtask.budget) {
+        /* the same position and level always give the same move */
+        searchreset();
+        nodecount = 0;
+        nodelimit = nodebudget;
+    } else {
+        memset(killers, 0, sizeof(killers));
+    }
+    /* deepen to searchdepth or until the budget runs out, the last */
+    /* completed depth decides, so a stopped search still has its move. */
+    /* the best move of each depth is searched first at the next one */
+    searchtask.depth = 1;
+    searchtask.best = searchtask.played;
+    startdepth();
+    return(1);
+}
+
+/**
+ * puts the root of the next depth on the search stack
+ */
+void startdepth(void) {
+    arenatop = 0;
+    frames[0].depth = searchtask.depth;
+    frames[0].alpha = -10000;
+    frames[0].beta = 10000;
+    frames[0].color = searchtask.color;
+    searchtask.state = SEARCH_RUNNING;
+}
+
+/**
+ * the root does what alphabeta does, except that it counts no nodes
+ * against the limits and keeps the best move in searchtask.best
+ */
+int enterroot(struct searchframe *f) {
+    if (*play || stopsearch) {
+        f->value = 0;
+        return(NODE_DONE);
+    }
+    STAT(searchstats.nodes++);
+    STAT(pvlength[ply] = ply);
+
+    /* test if captures are possible */
+    f->capture = testcapture(f->color);
+    if(f->depth == 0) {
+        if(f->capture == 0) {
+            STAT(searchstats.leaves++);
+            f->value = cachedevaluation(f->color);
+            return(NODE_DONE);
+        }
+        f->depth = 1;
+    }
+    f->bestmove = 0;
+    initpicker(&f->picker, f->color, f->capture);
+    return(NODE_OPEN);
+}
+
+int nextroot(struct searchframe *f) {
+    struct searchframe *child = f + 1;
+    struct move2 *move;
+
+    if((move = nextmove(&f->picker)) == NULL) {
+        /* if there are no possible moves, we lose: */
+        if(f->picker.next == 0) {
+            f->value = f->color == BLACK ? -5000 : 5000;
+            return(NODE_DONE);
+        }
+        if(f->bestmove != 0) {
+            ttable[hashkey & (TTSIZE - 1)].lock = hashkey >> 16;
+            ttable[hashkey & (TTSIZE - 1)].move = f->bestmove;
+        }
+        f->value = f->color == BLACK ? f->alpha : f->beta;
+        return(NODE_DONE);
+    }
+    domove(*move);
+    pushposition(move);
+    f->move = move;
+    child->color = f->color ^ CHANGECOLOR;
+    child->depth = f->depth - 1;
+    child->alpha = f->alpha;
+    child->beta = f->beta;
+    return(NODE_CHILD);
+}
+
+int rootdone(struct searchframe *f, int value) {
+    struct move2 *move = f->move;
+
+    popposition();
+    undomove(*move);
+    if(stopsearch || *play) {
+        /* the depth is not finished, enddepth() keeps the last one */
+        f->value = 0;
+        return(NODE_DONE);
+    }
+    if(f->color == BLACK ? value >= f->beta : value <= f->alpha) {
+        storemove(move, f->capture);
+        f->value = value;
+        return(NODE_DONE);
+    }
+    if(f->color == BLACK ? value > f->alpha : value < f->beta) {
+        if(f->color == BLACK) {
+            f->alpha = value;
+        } else {
+            f->beta = value;
+        }
+        searchtask.best = *move;
+        f->bestmove = MOVECODE(move);
+        STAT(updatepv(move));
+    }
+    return(NODE_NEXT);
+}
+
+/**
+ * the root of the last depth has its value: goes on with the next depth
+ * or ends the search
+ */
+void enddepth(int value) {
+    if(!stopsearch && !*play) {
+        searchtask.played = searchtask.best;
+        searchtask.eval = value;
+        STAT(savepv());
+        if(searchtask.depth++ < (searchtask.budget ? MAXANALYSIS : searchdepth)) {
+            startdepth();
+            return;
+        }
+    }
+    searchtask.depth--;
+    nodelimit = 0;
+    searchtask.state = SEARCH_DONE;
+}
+
+/**
+ * the search: runs the search stack from action at frames[ply] until the
+ * node at frames[base] has its value, NODE_DONE, or until *nodes more
+ * nodes are entered, NODE_CHILD, with the next one set up to go on with.
+ * nodes is NULL for no limit. the node at ply 0 is the root. the stack
+ * is static, so nothing here grows with the depth searched
+ */
+int searchframes(int action, int base, uint32_t *nodes) {
+    for(;;) {
+        struct searchframe *f = &frames[ply];
+
+        switch(action) {
+        case NODE_CHILD:
+            /* the node in frames[ply] is set up but not entered */
+            if(nodes != NULL && (*nodes)-- == 0) {
+                *nodes = 0;
+                return(NODE_CHILD);
+            }
+            if(ply == 0) {
+                action = enterroot(f);
+            } else {
+                action = f->color == BLACK ? enternode_black(f) : enternode_white(f);
+            }
+            break;
+        case NODE_OPEN:
+        case NODE_NEXT:
+            if(ply == 0) {
+                action = nextroot(f);
+            } else {
+                action = f->color == BLACK ? nextchild_black(f) : nextchild_white(f);
+            }
+            break;
+        case NODE_DONE:
+            /* hand the value of the node to the one below */
+            if(ply == base) {
+                return(NODE_DONE);
+            }
+            if(ply == 1) {
+                action = rootdone(f - 1, f->value);
+            } else {
+                action = f[-1].color == BLACK ? childdone_black(f - 1, f->value) : childdone_white(f - 1, f->value);
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * goes on with the search for up to nodes more nodes, all of it for 0.
+ * returns 1 while it is not done. between two calls nothing may touch
+ * the engine's board
+ */
+uint8_t searchrun(uint32_t nodes) {
+    while(searchtask.state == SEARCH_RUNNING) {
+        if(searchframes(NODE_CHILD, 0, nodes != 0 ? &nodes : NULL) == NODE_CHILD) {
+            return(1);
+        }
+        enddepth(frames[0].value);
+    }
+    return(0);
+}
+
+/**
+ * ends the search at once, it plays the best move of the last depth it
+ * completed
+ */
+void searchstop(void) {
+    stopsearch = 1;
+}
+
+/**
+ * purpose: search the game tree from the node at ply, where color is to
+ * move, and return its value. the search runs on frames[ply] and up
+ */
+int alphabeta(int depth, int alpha, int beta, uint8_t color) {
+    struct searchframe *f = &frames[ply];
+
+    f->depth = depth;
+    f->alpha = alpha;
+    f->beta = beta;
+    f->color = color;
+    searchframes(NODE_CHILD, ply, NULL);
+    return(f->value);
+}
+
+/**
+ * purpose: search the game tree from the root and find the best move,
+ * which is left in best if one beats the window.
+ */
+int firstalphabeta(int depth, int alpha, int beta, uint8_t color, struct move2 *best) {
+    int value;
+
+    searchtask.best = *best;
+    value = alphabeta(depth, alpha, beta, color);
+    *best = searchtask.best;
+    return(value);
+}
+
+/* the per side search and move generation */
+#define SIDE BLACK
+#include "side.h"
+#undef SIDE
+#define SIDE WHITE
+#include "side.h"
+#undef SIDE
+
+/**
+ * remembers a move that failed high: in the best move table, and as a
+ * killer of this ply if it was a quiet move
+ */
+void storemove(struct move2 *move, int capture) {
+    uint16_t code = MOVECODE(move);
+
+    ttable[hashkey & (TTSIZE - 1)].lock = hashkey >> 16;
+    ttable[hashkey & (TTSIZE - 1)].move = code;
+    if(capture == 0 && killers[ply][0] != code) {
+        killers[ply][1] = killers[ply][0];
+        killers[ply][0] = code;
+    }
+}
+
+void initpicker(struct movepicker *picker, uint8_t color, int capture) {
+    picker->base = arenatop;
+    picker->list = &movearena[arenatop];
+    picker->n = 0;
+    picker->next = 0;
+    picker->ntried = 0;
+    picker->skip = 0;
+    picker->stage = STAGE_TT;
+    picker->color = color;
+    picker->capture = capture;
+}
+
+/**
+ * returns the next move of the node or NULL once all are tried. the
+ * stages are generated into the node's arena slots one after the other,
+ * each only when the moves before it are used up. arenatop is set past
+ * the moves generated so far, so the caller needs no bookkeeping.
+ */
+struct move2 *nextmove(struct movepicker *picker) {
+    struct move2 *list = picker->list;
+    uint16_t code;
+    int i, j, n;
+
+    while(picker->next == picker->n) {
+        switch(picker->stage++) {
+        case STAGE_TT:
+            if(ttable[hashkey & (TTSIZE - 1)].lock != (uint16_t)(hashkey >> 16)) {
+                break;
+            }
+            code = ttable[hashkey & (TTSIZE - 1)].move;
+            if(picker->capture) {
+                /* all captures of the piece, the stored one first */
+                i = code >> 8;
+                if(i < 5 || i > 40 || (cboard[i] & picker->color) == 0) {
+                    break;
+                }
+                capturesequences(&picker->n, list, i);
+                picker->skip = i;
+                for(j = 1; j < picker->n; j++) {
+                    if(MOVECODE(&list[j]) == code) {
+                        struct move2 swap = list[0];
+                        list[0] = list[j];
+                        list[j] = swap;
+                        break;
+                    }
+                }
+            } else if(stepmove(&list[0], code, picker->color)) {
+                picker->tried[picker->ntried++] = code;
+                picker->n = 1;
+            }
+            STAT(if(picker->n) searchstats.tthits++);
+            break;
+        case STAGE_CAPTURES:
+            if(!picker->capture) {
+                break;
+            }
+            for(i = 5; i <= 40; i++) {
+                if( (cboard[i] & picker->color) != 0 && i != picker->skip) {
+                    capturesequences(&picker->n, list, i);
+                }
+            }
+            /* a capture position has no other moves */
+            picker->stage = STAGE_DONE;
+            break;
+        case STAGE_KILLERS:
+            for(i = 0; i < 2; i++) {
+                code = killers[ply][i];
+                if(code != 0 && (picker->ntried == 0 || code != picker->tried[0]) &&
+                   stepmove(&list[picker->n], code, picker->color)) {
+                    picker->tried[picker->ntried++] = code;
+                    picker->n++;
+                    STAT(searchstats.killerhits++);
+                }
+            }
+            break;
+        case STAGE_QUIETS:
+            /* everything, less the moves that were already tried */
+            n = generatemovelist(&list[picker->n], picker->color);
+            for(i = 0, j = picker->n; i < n; i++) {
+                struct move2 *move = &list[picker->n + i];
+                code = MOVECODE(move);
+                if( (picker->ntried > 0 && code == picker->tried[0]) ||
+                    (picker->ntried > 1 && code == picker->tried[1]) ||
+                    (picker->ntried > 2 && code == picker->tried[2]) ) {
+                    continue;
+                }
+                if(j != picker->n + i) {
+                    list[j] = *move;
+                }
+                j++;
+            }
+            picker->n = j;
+            break;
+        default:
+            return(NULL);
+        }
+        arenatop = picker->base + picker->n;
+        STAT(if(arenatop > searchstats.arenapeak) searchstats.arenapeak = arenatop);
+    }
+    arenatop = picker->base + picker->n;
+    return(&list[picker->next++]);
 }
 
 /**
- * purpose: entry point to checkers. find a move on iboard b for color
- * in the time specified by maxtime, write the best move in
- * iboard, returns information on the search in str
- * returns 1 if a move is found & executed, 0, if there is no legal
- * move in this position.
+ * builds the quiet move from << 8 | to into move if it is legal for
+ * color in the current position. used to check moves that come from the
+ * best move table or the killers rather than from the generator
  */
-int checkers(uint8_t color) {
-    int numberofmoves;
-    int eval;
-    struct move2 best, movelist[MAXMOVES];
+int stepmove(struct move2 *move, uint16_t code, uint8_t color) {
+    int from = code >> 8;
+    int to = code & 255;
+    int piece, after;
 
-    /* check if there is only one move */
-    numberofmoves = generatecapturelist(movelist, color);
-    if(numberofmoves == 1) {
-        domove(movelist[0]);
-        return(1); /* forced capture */
-    } else if (numberofmoves == 0) {
-        numberofmoves = generatemovelist(movelist, color);
-        if(numberofmoves == 1) {
-            domove(movelist[0]);
-            return(1); /* only one move */
+    if(from < 5 || from > 40 || to < 5 || to > 40) {
+        return(0);
+    }
+    piece = cboard[from];
+    if( (piece & color) == 0 || (cboard[to] & FREE) == 0 ) {
+        return(0);
+    }
+    switch(to - from) {
+    case 4: case 5:
+        if( (piece & (WHITE | MAN)) == (WHITE | MAN) ) {
+            return(0);
         }
-        if(numberofmoves == 0) {
-            return(0); /* no legal moves */
+        break;
+    case -4: case -5:
+        if( (piece & (BLACK | MAN)) == (BLACK | MAN) ) {
+            return(0);
         }
+        break;
+    default:
+        return(0);
     }
-    
-    eval = firstalphabeta(1, -10000, 10000, color, &best);
-    
-    movetonotation(best);
-    domove(best);
-    
-    return eval;
+    after = piece;
+    if( (piece & MAN) && (to >= 37 || to <= 8) ) {
+        after = (piece & (BLACK | WHITE)) | KING;
+    }
+    move->n = 2;
+    move->m[0] = (FREE << 16) | (piece << 8) | from;
+    move->m[1] = (after << 16) | (FREE << 8) | to;
+    return(1);
 }
 
-
-/**
- * purpose: search the game tree and find the best move.
- */
-int firstalphabeta(int depth, int alpha, int beta, uint8_t color, struct move2 *best) {
+void domove(struct move2 move) {
     int i;
-    int numberofmoves;
-    int capture;
-    struct move2 movelist[MAXMOVES];
 
-    if (*play) {
-        return 0;
+    for(i = 0; i < move.n; i++) {
+        int square = (move.m[i] % 256);
+        int before = ((move.m[i] >> 8) % 256);
+        int after = ((move.m[i] >> 16) % 256);
+        cboard[square] = after;
+        hashkey ^= PIECEKEY(square, before) ^ PIECEKEY(square, after);
+#if EGDB
+        piececount += (after != FREE) - (before != FREE);
+#endif
+#if BOARD_BITBOARD
+        TOGGLEPIECE(square, before);
+        TOGGLEPIECE(square, after);
+#endif
     }
-    /* test if captures are possible */
-    capture = testcapture(color);
+    hashkey ^= zobristside;
+}
 
-    /* recursion termination if no captures and depth=0*/
-    if(depth == 0) {
-        if(capture == 0) {
-            return(evaluation(color));
-        } else {
-            depth = 1;
-        }
+void undomove(struct move2 move) {
+    int i;
+
+    /* backwards, a king can end its jumps on the square it started from */
+    for(i = move.n - 1; i >= 0; i--) {
+        int square = (move.m[i] % 256);
+        int before = ((move.m[i] >> 8) % 256);
+        int after = ((move.m[i] >> 16) % 256);
+        cboard[square] = before;
+        hashkey ^= PIECEKEY(square, before) ^ PIECEKEY(square, after);
+#if EGDB
+        piececount += (before != FREE) - (after != FREE);
+#endif
+#if BOARD_BITBOARD
+        TOGGLEPIECE(square, before);
+        TOGGLEPIECE(square, after);
+#endif
     }
+    hashkey ^= zobristside;
+}
 
-    /* generate all possible moves in the position */
-    if(capture == 0) {
-        numberofmoves = generatemovelist(movelist, color);
-        /* if there are no possible moves, we lose: */
-        if(numberofmoves == 0)  {
-            if (color == BLACK) {
-                return(-5000);
-            } else {
-                return(5000);
-            }
-        }
+/**
+ * puts the position after move on the history stack, the caller pops it
+ * with popposition once the move is taken back
+ */
+void pushposition(struct move2 *move) {
+    ply++;
+    hashtop++;
+    hashstack[hashtop] = hashkey;
+    if(move->n == 2 && (((move->m[0] >> 8) % 256) & KING)) {
+        quiet[hashtop] = quiet[hashtop - 1] == 255 ? 255 : quiet[hashtop - 1] + 1;
     } else {
-        numberofmoves = generatecapturelist(movelist, color);
+        quiet[hashtop] = 0;
     }
+}
 
-    /* for all moves: execute the move, search tree, undo move. */
-    for(i = 0; i < numberofmoves; i++) {
-	int value;
-        if((os_GetCSC()) == 0x0F) {
-            *play = 1;
-            return 0;
-        }
-        
-        domove(movelist[i]);
+void popposition(void) {
+    ply--;
+    hashtop--;
+}
 
-        value = alphabeta(depth - 1, alpha, beta, (color ^ CHANGECOLOR));
+/**
+ * purpose: test if the position on top of the history stack already
+ * occurred since the last irreversible move, or the quiet move limit is hit
+ */
+int repetition(void) {
+    int i;
+    int last = hashtop - quiet[hashtop];
 
-        undomove(movelist[i]);
-        if(color == BLACK) {
-            if(value >= beta) {
-                return(value);
-            }
-            if(value > alpha) {
-                alpha = value;
-                *best = movelist[i];
-            }
-        }
-        if(color == WHITE) {
-            if(value <= alpha) {
-                return(value);
-            }
-            if(value < beta)   {
-                beta = value;
-                *best = movelist[i];
-            }
-        }
+    if(quiet[hashtop] >= drawplies) {
+        return(1);
     }
-    if(color == BLACK) {
-        return(alpha);
+    for(i = hashtop - 4; i >= last; i -= 2) {
+        if(hashstack[i] == hashkey) {
+            return(1);
+        }
     }
-    return(beta);
+    return(0);
 }
 
+#if EGDB
 /**
- * purpose: search the game tree and find the best move.
+ * value of the position with color to move in the endgame databases,
+ * UNKNOWN if they don't have it
  */
-int alphabeta(int depth, int alpha, int beta, uint8_t color) {
+int egdbprobe(uint8_t color) {
+    struct egdbposition pos;
     int i;
-    int capture;
-    int numberofmoves;
-    struct move2 movelist[MAXMOVES];
 
-    if (*play) {
-        return 0;
-    }
-    /* test if captures are possible */
-    capture = testcapture(color);
+    pos.blackmen = pos.blackkings = pos.whitemen = pos.whitekings = 0;
+    for(i = 0; i < 32; i++) {
+        uint32_t bit = (uint32_t)1 << i;
 
-    /* recursion termination if no captures and depth=0*/
-    if(depth == 0) {
-        if(capture == 0) {
-            return(evaluation(color));
-        } else {
-            depth = 1;
+        switch(cboard[i + 5 + (i + 4) / 8]) {
+        case BLACK | MAN:  pos.blackmen |= bit; break;
+        case BLACK | KING: pos.blackkings |= bit; break;
+        case WHITE | MAN:  pos.whitemen |= bit; break;
+        case WHITE | KING: pos.whitekings |= bit; break;
+        default: break;
         }
     }
+    if(color == WHITE) {
+        egdbmirror(&pos);
+    }
+    return(egdblookup(&pos));
+}
+#endif
 
-    /* generate all possible moves in the position */
-    if(capture == 0) {
-        numberofmoves = generatemovelist(movelist, color);
-        /* if there are no possible moves, we lose: */
-        if(numberofmoves == 0)  {
-            if (color == BLACK) {
-                return(-5000);
-            } else {
-                return(5000);
-            }
-        }
+/**
+ * evaluation() through the evaluation cache
+ */
+int cachedevaluation(uint8_t color) {
+    int value;
+#if EVALCACHESIZE
+    struct evalentry *entry = &evalcache[hashkey & (EVALCACHESIZE - 1)];
+
+    if(entry->key == hashkey) {
+        STAT(searchstats.evalhits++);
+        value = entry->value;
     } else {
-        numberofmoves = generatecapturelist(movelist, color);
+        entry->key = hashkey;
+        entry->value = evaluation(color);
+        value = entry->value;
     }
-    
-    /* for all moves: execute the move, search tree, undo move. */
-    for(i = 0; i < numberofmoves; i++) {
-        int value;
-        domove(movelist[i]);
-
-        value = alphabeta(depth - 1, alpha, beta, color ^ CHANGECOLOR);
+#else
+    value = evaluation(color);
+#endif
 
-        undomove(movelist[i]);
-
-        if(color == BLACK) {
-            if(value >= beta) {
-                return(value);
-            }
-            if(value > alpha) {
-                alpha = value;
-            }
-        }
-        if(color == WHITE) {
-            if(value <= alpha) {
-                return(value);
-            }
-            if(value < beta) {
-                beta = value;
-            }
-        }
+    /* the noise comes from the high bits of the scrambled position key */
+    if(evalnoise != 0) {
+        value += (int)(((uint32_t)(hashkey * 2654435761UL) >> 16) % (2 * evalnoise + 1)) - evalnoise;
     }
-    if(color == BLACK) {
-        return(alpha);
-    }
-    return(beta);
+    return(value);
 }
 
-void domove(struct move2 move) {
-    int i;
+/**
+ * evaluators of endings, picked by evaluation() from the material
+ * signature, the piece counts of both sides. each keeps the terms that
+ * still mean something with that material and adds the ones that decide
+ * it; all other positions go through the full evaluation.
+ */
+#define EVAL_GENERAL 0
+#define EVAL_KINGS 1    /* kings only */
+#define EVAL_RACE 2     /* men only, at most RACEPIECES */
+#define EVAL_LOPSIDED 3 /* kings on the board and a side ahead, at most LOPSIDEDPIECES */
+
+#define RACEPIECES 8
+#define LOPSIDEDPIECES 8
+
+/* what a king on a cboard square is worth: the center and the edges */
+#define KC 5
+#define KE (-5)
+const int8_t kingsquare[46] = {
+    0, 0, 0, 0, 0, KE, KE, KE,
+    KE, 0, 0, 0, 0, KE, KE, KC,
+    KC, 0, 0, 0, KC, KC, KE, KE,
+    KC, KC, 0, 0, 0, KC, KC, KE,
+    KE, 0, 0, 0, 0, KE, KE, KE,
+    KE, 0, 0, 0, 0, 0
+};
 
-    for(i = 0; i < move.n; i++) {
-        int square = (move.m[i] % 256);
-        int after = ((move.m[i] >> 16) % 256);
-        cboard[square] = after;
-    }
-}
+/* back rank guard by the men on the four squares of a back rank */
+const int8_t backrankguard[16] = { 0, -1, 1, 0, 1, 1, 2, 1, 1, 0, 7, 4, 2, 2, 9, 8 };
 
-void undomove(struct move2 move) {
-    int i;
+/* the squares a king holds out longest on, the two double corners */
+const uint8_t doublecorner[4] = {8, 13, 32, 37};
 
-    for(i = 0; i < move.n; i++) {
-        int square = (move.m[i] % 256);
-        int before = ((move.m[i] >> 8) % 256);
-        cboard[square] = before;
+int  evalkings(int eval, uint8_t color, int nbk, int nwk);
+int  evalrace(int eval, uint8_t color, int nbm, int nwm);
+int  evallopsided(int eval, uint8_t color);
+
+/**
+ * the evaluator for the material signature nbm, nbk, nwm, nwk
+ */
+int materialclass(int nbm, int nbk, int nwm, int nwk) {
+    int pieces = nbm + nbk + nwm + nwk;
+
+    if(nbm + nwm == 0) {
+        return(EVAL_KINGS);
+    }
+    if(nbk + nwk == 0) {
+        return(pieces <= RACEPIECES ? EVAL_RACE : EVAL_GENERAL);
     }
+    if(nbm + nbk != nwm + nwk && pieces <= LOPSIDEDPIECES) {
+        return(EVAL_LOPSIDED);
+    }
+    return(EVAL_GENERAL);
 }
 
 int evaluation(uint8_t color) {
@@ -507,6 +1898,15 @@ int evaluation(uint8_t color) {
 
     nm = nbm + nwm;
     nk = nbk + nwk;
+
+    switch(materialclass(nbm, nbk, nwm, nwk)) {
+    case EVAL_KINGS:
+        return(evalkings(eval, color, nbk, nwk));
+    case EVAL_RACE:
+        return(evalrace(eval, color, nbm, nwm));
+    case EVAL_LOPSIDED:
+        return(evallopsided(eval, color));
+    }
     /*--------- fine evaluation below -------------*/
 
     if(color == BLACK) {
@@ -745,1042 +2145,286 @@ int evaluation(uint8_t color) {
 
 
 
-/* MOVE GENERATION */
+/**
+ * 1 if color, to move, has the move: the pieces on its system, the rows
+ * it starts from and every second row after them, are odd in number.
+ * oddrows of the pieces on the board stand on odd rows
+ */
+int themove(uint8_t color, int pieces, int oddrows) {
+    return((color == WHITE ? oddrows : pieces - oddrows) & 1);
+}
 
 /**
- * purpose:generates all moves. no captures. returns number of moves
+ * the distance of a king on SQ_INDEX square a to a piece on b, in moves
  */
-int generatemovelist(struct move2 movelist[MAXMOVES], uint8_t color) {
-    int n = 0, m;
-    int i;
+int kingdistance(int a, int b) {
+    int dx = abs(SQ_COL(a) - SQ_COL(b)), dy = abs(SQ_ROW(a) - SQ_ROW(b));
 
-    if(color == BLACK) {
-        for(i = 5; i <= 40; i++) {
-            if( (cboard[i]&BLACK) != 0 ) {
-                if( (cboard[i]&MAN) != 0 ) {
-                    if( (cboard[i + 4] & FREE) != 0 ) {
-                        movelist[n].n = 2;
-                        if(i >= 32) {
-                            m = (BLACK | KING);
-                        } else {
-                            m = (BLACK | MAN);
-                        }
-                        m = m << 8;
-                        m += FREE;
-                        m = m << 8;
-                        m += i + 4;
-                        movelist[n].m[1] = m;
-                        m = FREE;
-                        m = m << 8;
-                        m += (BLACK | MAN);
-                        m = m << 8;
-                        m += i;
-                        movelist[n].m[0] = m;
-                        n++;
-                    }
-                    if( (cboard[i + 5] & FREE) != 0 ) {
-                        movelist[n].n = 2;
-                        if(i >= 32) {
-                            m = (BLACK | KING);
-                        } else {
-                            m = (BLACK | MAN);
-                        }
-                        m = m << 8;
-                        m += FREE;
-                        m = m << 8;
-                        m += i + 5;
-                        movelist[n].m[1] = m;
-                        m = FREE;
-                        m = m << 8;
-                        m += (BLACK | MAN);
-                        m = m << 8;
-                        m += i;
-                        movelist[n].m[0] = m;
-                        n++;
-                    }
-                }
-                if( (cboard[i]&KING) != 0 ) {
-                    if( (cboard[i + 4] & FREE) != 0 ) {
-                        movelist[n].n = 2;
-                        m = (BLACK | KING);
-                        m = m << 8;
-                        m += FREE;
-                        m = m << 8;
-                        m += i + 4;
-                        movelist[n].m[1] = m;
-                        m = FREE;
-                        m = m << 8;
-                        m += (BLACK | KING);
-                        m = m << 8;
-                        m += i;
-                        movelist[n].m[0] = m;
-                        n++;
-                    }
-                    if( (cboard[i + 5] & FREE) != 0 ) {
-                        movelist[n].n = 2;
-                        m = (BLACK | KING);
-                        m = m << 8;
-                        m += FREE;
-                        m = m << 8;
-                        m += i + 5;
-                        movelist[n].m[1] = m;
-                        m = FREE;
-                        m = m << 8;
-                        m += (BLACK | KING);
-                        m = m << 8;
-                        m += i;
-                        movelist[n].m[0] = m;
-                        n++;
-                    }
-                    if( (cboard[i - 4] & FREE) != 0 ) {
-                        movelist[n].n = 2;
-                        m = (BLACK | KING);
-                        m = m << 8;
-                        m += FREE;
-                        m = m << 8;
-                        m += i - 4;
-                        movelist[n].m[1] = m;
-                        m = FREE;
-                        m = m << 8;
-                        m += (BLACK | KING);
-                        m = m << 8;
-                        m += i;
-                        movelist[n].m[0] = m;
-                        n++;
-                    }
-                    if( (cboard[i - 5] & FREE) != 0 ) {
-                        movelist[n].n = 2;
-                        m = (BLACK | KING);
-                        m = m << 8;
-                        m += FREE;
-                        m = m << 8;
-                        m += i - 5;
-                        movelist[n].m[1] = m;
-                        m = FREE;
-                        m = m << 8;
-                        m += (BLACK | KING);
-                        m = m << 8;
-                        m += i;
-                        movelist[n].m[0] = m;
-                        n++;
-                    }
-                }
-            }
-        }
-    } else { /* color = WHITE */
-        for(i = 5; i <= 40; i++) {
-            if( (cboard[i]&WHITE) != 0 ) {
-                if( (cboard[i]&MAN) != 0 ) {
-                    if( (cboard[i - 4] & FREE) != 0 ) {
-                        movelist[n].n = 2;
-                        if(i <= 13) {
-                            m = (WHITE | KING);
-                        } else {
-                            m = (WHITE | MAN);
-                        }
-                        m = m << 8;
-                        m += FREE;
-                        m = m << 8;
-                        m += i - 4;
-                        movelist[n].m[1] = m;
-                        m = FREE;
-                        m = m << 8;
-                        m += (WHITE | MAN);
-                        m = m << 8;
-                        m += i;
-                        movelist[n].m[0] = m;
-                        n++;
-                    }
-                    if( (cboard[i - 5] & FREE) != 0 ) {
-                        movelist[n].n = 2;
-                        if(i <= 13) {
-                            m = (WHITE | KING);
-                        } else {
-                            m = (WHITE | MAN);
-                        }
-                        m = m << 8;
-                        m += FREE;
-                        m = m << 8;
-                        m += i - 5;
-                        movelist[n].m[1] = m;
-                        m = FREE;
-                        m = m << 8;
-                        m += (WHITE | MAN);
-                        m = m << 8;
-                        m += i;
-                        movelist[n].m[0] = m;
-                        n++;
-                    }
-                }
-                if( (cboard[i]&KING) != 0 ) { /* or else */
-                    if( (cboard[i + 4] & FREE) != 0 ) {
-                        movelist[n].n = 2;
-                        m = (WHITE | KING);
-                        m = m << 8;
-                        m += FREE;
-                        m = m << 8;
-                        m += i + 4;
-                        movelist[n].m[1] = m;
-                        m = FREE;
-                        m = m << 8;
-                        m += (WHITE | KING);
-                        m = m << 8;
-                        m += i;
-                        movelist[n].m[0] = m;
-                        n++;
-                    }
-                    if( (cboard[i + 5] & FREE) != 0 ) {
-                        movelist[n].n = 2;
-                        m = (WHITE | KING);
-                        m = m << 8;
-                        m += FREE;
-                        m = m << 8;
-                        m += i + 5;
-                        movelist[n].m[1] = m;
-                        m = FREE;
-                        m = m << 8;
-                        m += (WHITE | KING);
-                        m = m << 8;
-                        m += i;
-                        movelist[n].m[0] = m;
-                        n++;
-                    }
-                    if( (cboard[i - 4] & FREE) != 0 ) {
-                        movelist[n].n = 2;
-                        m = (WHITE | KING);
-                        m = m << 8;
-                        m += FREE;
-                        m = m << 8;
-                        m += i - 4;
-                        movelist[n].m[1] = m;
-                        m = FREE;
-                        m = m << 8;
-                        m += (WHITE | KING);
-                        m = m << 8;
-                        m += i;
-                        movelist[n].m[0] = m;
-                        n++;
-                    }
-                    if( (cboard[i - 5] & FREE) != 0 ) {
-                        movelist[n].n = 2;
-                        m = (WHITE | KING);
-                        m = m << 8;
-                        m += FREE;
-                        m = m << 8;
-                        m += i - 5;
-                        movelist[n].m[1] = m;
-                        m = FREE;
-                        m = m << 8;
-                        m += (WHITE | KING);
-                        m = m << 8;
-                        m += i;
-                        movelist[n].m[0] = m;
-                        n++;
-                    }
-                }
-            }
-        }
-    }
-    return(n);
+    return(dx > dy ? dx : dy);
 }
 
 /**
- * generate all possible captures
+ * kings only: where the kings stand, and with even numbers the move,
+ * which decides most of these endings. a side ahead is drawn towards the
+ * weaker kings and out of the double corners they hold out in
  */
-int  generatecapturelist(struct move2 movelist[MAXMOVES], uint8_t color) {
-    int n = 0;
-    int m;
-    int i;
-    int tmp;
-
-    if(color == BLACK) {
-        for(i = 5; i <= 40; i++) {
-            if( (cboard[i] & BLACK) != 0) {
-                if( (cboard[i] & MAN) != 0) {
-                    if( (cboard[i + 4] & WHITE) != 0) {
-                        if( (cboard[i + 8] & FREE) != 0) {
-                            movelist[n].n = 3;
-                            if(i >= 28) {
-                                m = (BLACK | KING);
-                            } else {
-                                m = (BLACK | MAN);
-                            }
-                            m = m << 8;
-                            m += FREE;
-                            m = m << 8;
-                            m += i + 8;
-                            movelist[n].m[1] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += (BLACK | MAN);
-                            m = m << 8;
-                            m += i;
-                            movelist[n].m[0] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += cboard[i + 4];
-                            m = m << 8;
-                            m += i + 4;
-                            movelist[n].m[2] = m;
-                            blackmancapture(&n, movelist, i + 8);
-                        }
-                    }
-                    if( (cboard[i + 5] & WHITE) != 0) {
-                        if( (cboard[i + 10] & FREE) != 0) {
-                            movelist[n].n = 3;
-                            if(i >= 28) {
-                                m = (BLACK | KING);
-                            } else {
-                                m = (BLACK | MAN);
-                            }
-                            m = m << 8;
-                            m += FREE;
-                            m = m << 8;
-                            m += i + 10;
-                            movelist[n].m[1] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += (BLACK | MAN);
-                            m = m << 8;
-                            m += i;
-                            movelist[n].m[0] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += cboard[i + 5];
-                            m = m << 8;
-                            m += i + 5;
-                            movelist[n].m[2] = m;
-                            blackmancapture(&n, movelist, i + 10);
-                        }
-                    }
-                } else { /* cboard[i] is a KING */
-                    if( (cboard[i + 4] & WHITE) != 0) {
-                        if( (cboard[i + 8] & FREE) != 0) {
-                            movelist[n].n = 3;
-                            m = (BLACK | KING);
-                            m = m << 8;
-                            m += FREE;
-                            m = m << 8;
-                            m += i + 8;
-                            movelist[n].m[1] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += (BLACK | KING);
-                            m = m << 8;
-                            m += i;
-                            movelist[n].m[0] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += cboard[i + 4];
-                            m = m << 8;
-                            m += i + 4;
-                            movelist[n].m[2] = m;
-                            tmp = cboard[i + 4];
-                            cboard[i + 4] = FREE;
-                            cboard[i] = FREE;
-                            blackkingcapture(&n, movelist, i + 8);
-                            cboard[i + 4] = tmp;
-                            cboard[i] = BLACK | KING;
-                        }
-                    }
-                    if( (cboard[i + 5] & WHITE) != 0) {
-                        if( (cboard[i + 10] & FREE) != 0) {
-                            movelist[n].n = 3;
-                            m = (BLACK | KING);
-                            m = m << 8;
-                            m += FREE;
-                            m = m << 8;
-                            m += i + 10;
-                            movelist[n].m[1] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += (BLACK | KING);
-                            m = m << 8;
-                            m += i;
-                            movelist[n].m[0] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += cboard[i + 5];
-                            m = m << 8;
-                            m += i + 5;
-                            movelist[n].m[2] = m;
-                            tmp = cboard[i + 5];
-                            cboard[i + 5] = FREE;
-                            cboard[i] = FREE;
-                            blackkingcapture(&n, movelist, i + 10);
-                            cboard[i + 5] = tmp;
-                            cboard[i] = BLACK | KING;
-                        }
-                    }
-                    if( (cboard[i - 4] & WHITE) != 0) {
-                        if( (cboard[i - 8] & FREE) != 0) {
-                            movelist[n].n = 3;
-                            m = (BLACK | KING);
-                            m = m << 8;
-                            m += FREE;
-                            m = m << 8;
-                            m += i - 8;
-                            movelist[n].m[1] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += (BLACK | KING);
-                            m = m << 8;
-                            m += i;
-                            movelist[n].m[0] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += cboard[i - 4];
-                            m = m << 8;
-                            m += i - 4;
-                            movelist[n].m[2] = m;
-                            tmp = cboard[i - 4];
-                            cboard[i - 4] = FREE;
-                            cboard[i] = FREE;
-                            blackkingcapture(&n, movelist, i - 8);
-                            cboard[i - 4] = tmp;
-                            cboard[i] = BLACK | KING;
-                        }
-                    }
-                    if( (cboard[i - 5] & WHITE) != 0) {
-                        if( (cboard[i - 10] & FREE) != 0) {
-                            movelist[n].n = 3;
-                            m = (BLACK | KING);
-                            m = m << 8;
-                            m += FREE;
-                            m = m << 8;
-                            m += i - 10;
-                            movelist[n].m[1] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += (BLACK | KING);
-                            m = m << 8;
-                            m += i;
-                            movelist[n].m[0] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += cboard[i - 5];
-                            m = m << 8;
-                            m += i - 5;
-                            movelist[n].m[2] = m;
-                            tmp = cboard[i - 5];
-                            cboard[i - 5] = FREE;
-                            cboard[i] = FREE;
-                            blackkingcapture(&n, movelist, i - 10);
-                            cboard[i - 5] = tmp;
-                            cboard[i] = BLACK | KING;
-                        }
-                    }
-                }
-            }
-        }
-    } else { /* color is WHITE */
-        for(i = 5; i <= 40; i++) {
-            if( (cboard[i] & WHITE) != 0) {
-                if( (cboard[i] & MAN) != 0) {
-                    if( (cboard[i - 4] & BLACK) != 0) {
-                        if( (cboard[i - 8] & FREE) != 0) {
-                            movelist[n].n = 3;
-                            if(i <= 17) {
-                                m = (WHITE | KING);
-                            } else {
-                                m = (WHITE | MAN);
-                            }
-                            m = m << 8;
-                            m += FREE;
-                            m = m << 8;
-                            m += i - 8;
-                            movelist[n].m[1] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += (WHITE | MAN);
-                            m = m << 8;
-                            m += i;
-                            movelist[n].m[0] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += cboard[i - 4];
-                            m = m << 8;
-                            m += i - 4;
-                            movelist[n].m[2] = m;
-                            whitemancapture(&n, movelist, i - 8);
-                        }
-                    }
-                    if( (cboard[i - 5] & BLACK) != 0) {
-                        if( (cboard[i - 10] & FREE) != 0) {
-                            movelist[n].n = 3;
-                            if(i <= 17) {
-                                m = (WHITE | KING);
-                            } else {
-                                m = (WHITE | MAN);
-                            }
-                            m = m << 8;
-                            m += FREE;
-                            m = m << 8;
-                            m += i - 10;
-                            movelist[n].m[1] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += (WHITE | MAN);
-                            m = m << 8;
-                            m += i;
-                            movelist[n].m[0] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += cboard[i - 5];
-                            m = m << 8;
-                            m += i - 5;
-                            movelist[n].m[2] = m;
-                            whitemancapture(&n, movelist, i - 10);
-                        }
-                    }
-                } else { /* cboard[i] is a KING */
-                    if( (cboard[i + 4] & BLACK) != 0) {
-                        if( (cboard[i + 8] & FREE) != 0) {
-                            movelist[n].n = 3;
-                            m = (WHITE | KING);
-                            m = m << 8;
-                            m += FREE;
-                            m = m << 8;
-                            m += i + 8;
-                            movelist[n].m[1] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += (WHITE | KING);
-                            m = m << 8;
-                            m += i;
-                            movelist[n].m[0] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += cboard[i + 4];
-                            m = m << 8;
-                            m += i + 4;
-                            movelist[n].m[2] = m;
-                            tmp = cboard[i + 4];
-                            cboard[i + 4] = FREE;
-                            cboard[i] = FREE;
-                            whitekingcapture(&n, movelist, i + 8);
-                            cboard[i + 4] = tmp;
-                            cboard[i] = WHITE | KING;
-                        }
-                    }
-                    if( (cboard[i + 5] & BLACK) != 0) {
-                        if( (cboard[i + 10] & FREE) != 0) {
-                            movelist[n].n = 3;
-                            m = (WHITE | KING);
-                            m = m << 8;
-                            m += FREE;
-                            m = m << 8;
-                            m += i + 10;
-                            movelist[n].m[1] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += (WHITE | KING);
-                            m = m << 8;
-                            m += i;
-                            movelist[n].m[0] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += cboard[i + 5];
-                            m = m << 8;
-                            m += i + 5;
-                            movelist[n].m[2] = m;
-                            tmp = cboard[i + 5];
-                            cboard[i + 5] = FREE;
-                            cboard[i] = FREE;
-                            whitekingcapture(&n, movelist, i + 10);
-                            cboard[i + 5] = tmp;
-                            cboard[i] = WHITE | KING;
-                        }
-                    }
-                    if( (cboard[i - 4] & BLACK) != 0) {
-                        if( (cboard[i - 8] & FREE) != 0) {
-                            movelist[n].n = 3;
-                            m = (WHITE | KING);
-                            m = m << 8;
-                            m += FREE;
-                            m = m << 8;
-                            m += i - 8;
-                            movelist[n].m[1] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += (WHITE | KING);
-                            m = m << 8;
-                            m += i;
-                            movelist[n].m[0] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += cboard[i - 4];
-                            m = m << 8;
-                            m += i - 4;
-                            movelist[n].m[2] = m;
-                            tmp = cboard[i - 4];
-                            cboard[i - 4] = FREE;
-                            cboard[i] = FREE;
-                            whitekingcapture(&n, movelist, i - 8);
-                            cboard[i - 4] = tmp;
-                            cboard[i] = WHITE | KING;
-                        }
-                    }
-                    if( (cboard[i - 5] & BLACK) != 0) {
-                        if( (cboard[i - 10] & FREE) != 0) {
-                            movelist[n].n = 3;
-                            m = (WHITE | KING);
-                            m = m << 8;
-                            m += FREE;
-                            m = m << 8;
-                            m += i - 10;
-                            movelist[n].m[1] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += (WHITE | KING);
-                            m = m << 8;
-                            m += i;
-                            movelist[n].m[0] = m;
-                            m = FREE;
-                            m = m << 8;
-                            m += cboard[i - 5];
-                            m = m << 8;
-                            m += i - 5;
-                            movelist[n].m[2] = m;
-                            tmp = cboard[i - 5];
-                            cboard[i - 5] = FREE;
-                            cboard[i] = FREE;
-                            whitekingcapture(&n, movelist, i - 10);
-                            cboard[i - 5] = tmp;
-                            cboard[i] = WHITE | KING;
-                        }
-                    }
-                }
-            }
+int evalkings(int eval, uint8_t color, int nbk, int nwk) {
+    uint8_t strong = nbk > nwk ? (BLACK | KING) : (WHITE | KING);
+    int sign = nbk > nwk ? 1 : -1;
+    uint8_t strongkings[12], weakkings[12]; /* SQ_INDEX squares, 12 pieces a side at most */
+    int nstrong = 0, nweak = 0, oddrows = 0;
+    int i, j;
+
+    /* one pass for the squares, the lists of both sides and the move */
+    eval += color == BLACK ? 2 : -2;
+    for(i = 0; i < 32; i++) {
+        int square = i + 5 + (i + 4) / 8;
+        uint8_t piece = cboard[square];
+
+        if(piece == strong) {
+            strongkings[nstrong++] = i;
+        } else if(piece == (strong ^ CHANGECOLOR)) {
+            weakkings[nweak++] = i;
+        } else {
+            continue;
         }
+        eval += piece & BLACK ? kingsquare[square] : -kingsquare[square];
+        oddrows += SQ_ROW(i) & 1;
     }
-    return(n);
-}
+    if(nbk == nwk) {
+        return(eval + (themove(color, nbk + nwk, oddrows) == (color == BLACK) ? 16 : -16));
+    }
+    for(i = 0; i < nstrong; i++) {
+        int nearest = 7;
 
-void blackmancapture(int *n, struct move2 movelist[MAXMOVES], int i) {
-    int m;
-    int found = 0;
-    struct move2 move, orgmove;
+        for(j = 0; j < nweak; j++) {
+            int distance = kingdistance(strongkings[i], weakkings[j]);
 
-    orgmove = movelist[*n];
-    move = orgmove;
-    
-    if( (cboard[i + 4] & WHITE) != 0) {
-        if( (cboard[i + 8] & FREE) != 0) {
-            move.n++;
-            if(i >= 28) {
-                m = (BLACK | KING);
-            } else {
-                m = (BLACK | MAN);
+            if(distance < nearest) {
+                nearest = distance;
             }
-            m = m << 8;
-            m += FREE;
-            m = m << 8;
-            m += (i + 8);
-            move.m[1] = m;
-            m = FREE;
-            m = m << 8;
-            m += cboard[i + 4];
-            m = m << 8;
-            m += (i + 4);
-            move.m[move.n - 1] = m;
-            found = 1;
-            movelist[*n] = move;
-            blackmancapture(n, movelist, i + 8);
         }
+        eval -= sign * 2 * nearest;
     }
-    move = orgmove;
-    if( (cboard[i + 5] & WHITE) != 0) {
-        if( (cboard[i + 10] & FREE) != 0) {
-            move.n++;
-            if(i >= 28) {
-                m = (BLACK | KING);
-            } else {
-                m = (BLACK | MAN);
+    if(nweak < 3) {
+        for(i = 0; i < 4; i++) {
+            if(cboard[doublecorner[i]] == (strong ^ CHANGECOLOR)) {
+                eval -= sign * 15;
             }
-            m = m << 8;
-            m += FREE;
-            m = m << 8;
-            m += (i + 10);
-            move.m[1] = m;
-            m = FREE;
-            m = m << 8;
-            m += cboard[i + 5];
-            m = m << 8;
-            m += (i + 5);
-            move.m[move.n - 1] = m;
-            found = 1;
-            movelist[*n] = move;
-            blackmancapture(n, movelist, i + 10);
         }
     }
-    if(!found) {
-        (*n)++;
-    }
+    return(eval);
 }
 
-void  blackkingcapture(int *n, struct move2 movelist[MAXMOVES], int i) {
-    int m;
-    int tmp;
-    int found = 0;
-    struct move2 move, orgmove;
-
-    orgmove = movelist[*n];
-    move = orgmove;
-
-    if( (cboard[i - 4] & WHITE) != 0) {
-        if( (cboard[i - 8] & FREE) != 0) {
-            move.n++;
-            m = (BLACK | KING);
-            m = m << 8;
-            m += FREE;
-            m = m << 8;
-            m += i - 8;
-            move.m[1] = m;
-            m = FREE;
-            m = m << 8;
-            m += cboard[i - 4];
-            m = m << 8;
-            m += i - 4;
-            move.m[move.n - 1] = m;
-            found = 1;
-            movelist[*n] = move;
-            tmp = cboard[i - 4];
-            cboard[i - 4] = FREE;
-            blackkingcapture(n, movelist, i - 8);
-            cboard[i - 4] = tmp;
-        }
-    }
-    move = orgmove;
-    if( (cboard[i - 5] & WHITE) != 0) {
-        if( (cboard[i - 10] & FREE) != 0) {
-            move.n++;
-            m = (BLACK | KING);
-            m = m << 8;
-            m += FREE;
-            m = m << 8;
-            m += i - 10;
-            move.m[1] = m;
-            m = FREE;
-            m = m << 8;
-            m += cboard[i - 5];
-            m = m << 8;
-            m += i - 5;
-            move.m[move.n - 1] = m;
-            found = 1;
-            movelist[*n] = move;
-            tmp = cboard[i - 5];
-            cboard[i - 5] = FREE;
-            blackkingcapture(n, movelist, i - 10);
-            cboard[i - 5] = tmp;
-        }
-    }
-    move = orgmove;
-    if( (cboard[i + 4] & WHITE) != 0) {
-        if( (cboard[i + 8] & FREE) != 0) {
-            move.n++;
-            m = (BLACK | KING);
-            m = m << 8;
-            m += FREE;
-            m = m << 8;
-            m += i + 8;
-            move.m[1] = m;
-            m = FREE;
-            m = m << 8;
-            m += cboard[i + 4];
-            m = m << 8;
-            m += i + 4;
-            move.m[move.n - 1] = m;
-            found = 1;
-            movelist[*n] = move;
-            tmp = cboard[i + 4];
-            cboard[i + 4] = FREE;
-            blackkingcapture(n, movelist, i + 8);
-            cboard[i + 4] = tmp;
-        }
-    }
-    move = orgmove;
-    if( (cboard[i + 5] & WHITE) != 0) {
-        if( (cboard[i + 10] & FREE) != 0) {
-            move.n++;
-            m = (BLACK | KING);
-            m = m << 8;
-            m += FREE;
-            m = m << 8;
-            m += i + 10;
-            move.m[1] = m;
-            m = FREE;
-            m = m << 8;
-            m += cboard[i + 5];
-            m = m << 8;
-            m += i + 5;
-            move.m[move.n - 1] = m;
-            found = 1;
-            movelist[*n] = move;
-            tmp = cboard[i + 5];
-            cboard[i + 5] = FREE;
-            blackkingcapture(n, movelist, i + 10);
-            cboard[i + 5] = tmp;
+/**
+ * men only, few of them: a race to the last row. the man closest to
+ * crowning on each side, the side to move half a move closer, the back
+ * rank that holds the other side's men off, and the move with even
+ * numbers. how far the other men have come does not count
+ */
+int evalrace(int eval, uint8_t color, int nbm, int nwm) {
+    int black = 7, white = 7;   /* rows the leading man still has to go */
+    int oddrows = 0;
+    int i, code;
+
+    eval += color == BLACK ? 2 : -2;
+    for(i = 0; i < 32; i++) {
+        uint8_t piece = cboard[i + 5 + (i + 4) / 8];
+        int row = SQ_ROW(i);
+
+        if(piece == (BLACK | MAN)) {
+            black = 7 - row < black ? 7 - row : black;
+        } else if(piece == (WHITE | MAN)) {
+            white = row < white ? row : white;
+        } else {
+            continue;
         }
+        oddrows += row & 1;
     }
-    if(!found) {
-        (*n)++;
+    eval += 2 * (white - black) + (color == BLACK ? 1 : -1);
+
+    code = (cboard[5] & MAN ? 1 : 0) + (cboard[6] & MAN ? 2 : 0) + (cboard[7] & MAN ? 4 : 0) + (cboard[8] & MAN ? 8 : 0);
+    eval += 3 * backrankguard[code];
+    code = (cboard[40] & MAN ? 1 : 0) + (cboard[39] & MAN ? 2 : 0) + (cboard[38] & MAN ? 4 : 0) + (cboard[37] & MAN ? 8 : 0);
+    eval -= 3 * backrankguard[code];
+
+    if(nbm == nwm) {
+        eval += themove(color, nbm + nwm, oddrows) == (color == BLACK) ? 16 : -16;
     }
+    return(eval);
 }
 
-void  whitemancapture(int *n, struct move2 movelist[MAXMOVES], int i) {
-    int m;
-    int found = 0;
-    struct move2 move, orgmove;
+/**
+ * kings on the board and one side ahead, few pieces left: the material
+ * and where the kings stand. the terms of the men, back rank, cramp,
+ * center and tempo, only blur these endings
+ */
+int evallopsided(int eval, uint8_t color) {
+    int i;
 
-    orgmove = movelist[*n];
-    move = orgmove;
-    
-    if( (cboard[i - 4] & BLACK) != 0) {
-        if( (cboard[i - 8] & FREE) != 0) {
-            move.n++;
-            if(i <= 17) {
-                m = (WHITE | KING);
-            } else {
-                m = (WHITE | MAN);
-            }
-            m = m << 8;
-            m += FREE;
-            m = m << 8;
-            m += i - 8;
-            move.m[1] = m;
-            m = FREE;
-            m = m << 8;
-            m += cboard[i - 4];
-            m = m << 8;
-            m += i - 4;
-            move.m[move.n - 1] = m;
-            found = 1;
-            movelist[*n] = move;
-            whitemancapture(n, movelist, i - 8);
-        }
-    }
-    move = orgmove;
-    if( (cboard[i - 5] & BLACK) != 0) {
-        if( (cboard[i - 10] & FREE) != 0) {
-            move.n++;
-            if(i <= 17) {
-                m = (WHITE | KING);
-            } else {
-                m = (WHITE | MAN);
-            }
-            m = m << 8;
-            m += FREE;
-            m = m << 8;
-            m += i - 10;
-            move.m[1] = m;
-            m = FREE;
-            m = m << 8;
-            m += cboard[i - 5];
-            m = m << 8;
-            m += i - 5;
-            move.m[move.n - 1] = m;
-            found = 1;
-            movelist[*n] = move;
-            whitemancapture(n, movelist, i - 10);
+    eval += color == BLACK ? 2 : -2;
+    for(i = 5; i <= 40; i++) {
+        if(cboard[i] == (BLACK | KING)) {
+            eval += kingsquare[i];
+        } else if(cboard[i] == (WHITE | KING)) {
+            eval -= kingsquare[i];
         }
     }
-    if(!found) {
-        (*n)++;
-    }
+    return(eval);
 }
 
-void whitekingcapture(int *n, struct move2 movelist[MAXMOVES], int i) {
-    int m;
-    int tmp;
-    int found = 0;
-    struct move2 move, orgmove;
-
-    orgmove = movelist[*n];
-    move = orgmove;
-
-    if( (cboard[i - 4] & BLACK) != 0) {
-        if( (cboard[i - 8] & FREE) != 0) {
-            move.n++;
-            m = (WHITE | KING);
-            m = m << 8;
-            m += FREE;
-            m = m << 8;
-            m += i - 8;
-            move.m[1] = m;
-            m = FREE;
-            m = m << 8;
-            m += cboard[i - 4];
-            m = m << 8;
-            m += i - 4;
-            move.m[move.n - 1] = m;
-            found = 1;
-            movelist[*n] = move;
-            tmp = cboard[i - 4];
-            cboard[i - 4] = FREE;
-            whitekingcapture(n, movelist, i - 8);
-            cboard[i - 4] = tmp;
-        }
-    }
-    move = orgmove;
-    if( (cboard[i - 5] & BLACK) != 0) {
-        if( (cboard[i - 10] & FREE) != 0) {
-            move.n++;
-            m = (WHITE | KING);
-            m = m << 8;
-            m += FREE;
-            m = m << 8;
-            m += i - 10;
-            move.m[1] = m;
-            m = FREE;
-            m = m << 8;
-            m += cboard[i - 5];
-            m = m << 8;
-            m += i - 5;
-            move.m[move.n - 1] = m;
-            found = 1;
-            movelist[*n] = move;
-            tmp = cboard[i - 5];
-            cboard[i - 5] = FREE;
-            whitekingcapture(n, movelist, i - 10);
-            cboard[i - 5] = tmp;
-        }
+
+
+/* MOVE GENERATION */
+
+/**
+ * brings the board backend up to date after cboard was set up square by
+ * square rather than through domove
+ */
+void loadboard(void) {
+#if BOARD_BITBOARD || EGDB
+    int i;
+#endif
+
+#if BOARD_BITBOARD
+    pieces[BLACK] = pieces[WHITE] = kings = 0;
+    for(i = 5; i <= 40; i++) {
+        TOGGLEPIECE(i, cboard[i]);
     }
-    move = orgmove;
-    if( (cboard[i + 4] & BLACK) != 0) {
-        if( (cboard[i + 8] & FREE) != 0) {
-            move.n++;
-            m = (WHITE | KING);
-            m = m << 8;
-            m += FREE;
-            m = m << 8;
-            m += i + 8;
-            move.m[1] = m;
-            m = FREE;
-            m = m << 8;
-            m += cboard[i + 4];
-            m = m << 8;
-            m += i + 4;
-            move.m[move.n - 1] = m;
-            found = 1;
-            movelist[*n] = move;
-            tmp = cboard[i + 4];
-            cboard[i + 4] = FREE;
-            whitekingcapture(n, movelist, i + 8);
-            cboard[i + 4] = tmp;
-        }
+#endif
+#if EGDB
+    piececount = 0;
+    for(i = 5; i <= 40; i++) {
+        piececount += (cboard[i] & (BLACK | WHITE)) != 0;
     }
-    move = orgmove;
-    if( (cboard[i + 5] & BLACK) != 0) {
-        if( (cboard[i + 10] & FREE) != 0) {
-            move.n++;
-            m = (WHITE | KING);
-            m = m << 8;
-            m += FREE;
-            m = m << 8;
-            m += i + 10;
-            move.m[1] = m;
-            m = FREE;
-            m = m << 8;
-            m += cboard[i + 5];
-            m = m << 8;
-            m += i + 5;
-            move.m[move.n - 1] = m;
-            found = 1;
-            movelist[*n] = move;
-            tmp = cboard[i + 5];
-            cboard[i + 5] = FREE;
-            whitekingcapture(n, movelist, i + 10);
-            cboard[i + 5] = tmp;
-        }
+#endif
+}
+
+/**
+ * purpose:generates all moves. no captures. returns number of moves
+ */
+int generatemovelist(struct move2 movelist[MAXMOVES], uint8_t color) {
+    if(color == BLACK) {
+        return(generatemovelist_black(movelist));
     }
-    if(!found) {
-        (*n)++;
+    return(generatemovelist_white(movelist));
+}
+
+/**
+ * generate all possible captures
+ */
+int generatecapturelist(struct move2 movelist[MAXMOVES], uint8_t color) {
+    if(color == BLACK) {
+        return(generatecapturelist_black(movelist));
     }
+    return(generatecapturelist_white(movelist));
 }
 
 /**
- * purpose: test if color has a capture on b
+ * purpose: test if color has a capture on cboard
  */
 int testcapture(uint8_t color) {
-    int i;
-
     if(color == BLACK) {
-        for(i = 5; i <= 40; i++) {
-            if( (cboard[i] & BLACK) != 0) {
-                if( (cboard[i] & MAN) != 0) {
-                    if( (cboard[i + 4] & WHITE) != 0) {
-                        if( (cboard[i + 8] & FREE) != 0) {
-                            return(1);
-                        }
-                    }
-                    if( (cboard[i + 5] & WHITE) != 0) {
-                        if( (cboard[i + 10] & FREE) != 0) {
-                            return(1);
-                        }
-                    }
-                } else { /* cboard[i] is a KING */
-                    if( (cboard[i + 4] & WHITE) != 0) {
-                        if( (cboard[i + 8] & FREE) != 0) {
-                            return(1);
-                        }
-                    }
-                    if( (cboard[i + 5] & WHITE) != 0) {
-                        if( (cboard[i + 10] & FREE) != 0) {
-                            return(1);
-                        }
-                    }
-                    if( (cboard[i - 4] & WHITE) != 0) {
-                        if( (cboard[i - 8] & FREE) != 0) {
-                            return(1);
-                        }
-                    }
-                    if( (cboard[i - 5] & WHITE) != 0) {
-                        if( (cboard[i - 10] & FREE) != 0) {
-                            return(1);
-                        }
-                    }
-                }
+        return(testcapture_black());
+    }
+    return(testcapture_white());
+}
+
+/**
+ * appends every capture sequence of the piece on square to movelist.
+ * the jump tree is walked depth first with an explicit stack, in the
+ * same order the old recursive generators used: +4 +5 -4 -5 for the
+ * first jump of a king, -4 -5 +4 +5 for its further jumps, forward only
+ * for men. jumped pieces stay on cboard; they are tracked in a bitmask,
+ * can't be jumped twice and, like the square the piece started from,
+ * may be landed on again. the move is built in place and only copied
+ * out once per finished sequence.
+ */
+void capturesequences(int *n, struct move2 movelist[MAXMOVES], int square) {
+#if MOVEGEN_TABLES
+    /* directions of neighbor and landing */
+    static const int firstdirs[4] = {0, 1, 2, 3};
+    static const int kingdirs[4] = {2, 3, 0, 1};
+#else
+    static const int firstdirs[4] = {4, 5, -4, -5};
+    static const int kingdirs[4] = {-4, -5, 4, 5};
+#endif
+    const int *dirs;
+    int ndirs;
+    int at[MAXJUMPS + 1];       /* square after each jump */
+    uint8_t next[MAXJUMPS + 1]; /* next direction to try there, +8 once a jump was found */
+    int m[MAXJUMPS + 2];
+    int jumps = 0;
+    int from = square;
+    uint32_t captured = 0;
+    uint8_t piece = cboard[square];
+    uint8_t enemy = (piece & (BLACK | WHITE)) ^ CHANGECOLOR;
+
+    if(piece & KING) {
+        dirs = firstdirs;
+        ndirs = 4;
+    } else {
+        dirs = (piece & BLACK) ? firstdirs : &firstdirs[2];
+        ndirs = 2;
+    }
+
+    at[0] = square;
+    next[0] = 0;
+
+    for(;;) {
+        int d = next[jumps] & 7;
+
+        if(d < ndirs) {
+#if MOVEGEN_TABLES
+            int over = neighbor[from][dirs[d]];
+            int to = landing[from][dirs[d]];
+#else
+            int step = dirs[d];
+            int over = from + step;
+            int to = over + step;
+#endif
+
+            next[jumps]++;
+            if( (cboard[over] & enemy) != 0 && !(captured & squarebit[over]) &&
+                ((cboard[to] & FREE) != 0 || (captured & squarebit[to]) || to == square) ) {
+                next[jumps] |= 8;
+                m[2 + jumps] = (FREE << 16) | (cboard[over] << 8) | over;
+                captured |= squarebit[over];
+                jumps++;
+                at[jumps] = from = to;
+                next[jumps] = jumps == MAXJUMPS ? ndirs : 0;
+                dirs = (piece & KING) ? kingdirs : dirs;
             }
+            continue;
         }
-    } else { /* color is WHITE */
-        for(i = 5; i <= 40; i++) {
-            if( (cboard[i] & WHITE) != 0) {
-                if( (cboard[i] & MAN) != 0) {
-                    if( (cboard[i - 4] & BLACK) != 0) {
-                        if( (cboard[i - 8] & FREE) != 0) {
-                            return(1);
-                        }
-                    }
-                    if( (cboard[i - 5] & BLACK) != 0) {
-                        if( (cboard[i - 10] & FREE) != 0) {
-                            return(1);
-                        }
-                    }
-                } else { /* cboard[i] is a KING */
-                    if( (cboard[i + 4] & BLACK) != 0) {
-                        if( (cboard[i + 8] & FREE) != 0) {
-                            return(1);
-                        }
-                    }
-                    if( (cboard[i + 5] & BLACK) != 0) {
-                        if( (cboard[i + 10] & FREE) != 0) {
-                            return(1);
-                        }
-                    }
-                    if( (cboard[i - 4] & BLACK) != 0) {
-                        if( (cboard[i - 8] & FREE) != 0) {
-                            return(1);
-                        }
-                    }
-                    if( (cboard[i - 5] & BLACK) != 0) {
-                        if( (cboard[i - 10] & FREE) != 0) {
-                            return(1);
-                        }
-                    }
-                }
+
+        /* no further jump from here: the sequence is complete */
+        if(!(next[jumps] & 8)) {
+            struct move2 *move;
+            int after = piece;
+            int i;
+
+            if(jumps == 0) {
+                return;
             }
+            if( (piece & MAN) && (from >= 37 || from <= 8) ) {
+                after = (piece & (BLACK | WHITE)) | KING;
+            }
+            move = &movelist[(*n)++];
+            move->n = jumps + 2;
+            move->m[0] = (FREE << 16) | (piece << 8) | square;
+            move->m[1] = (after << 16) | (FREE << 8) | from;
+            for(i = 2; i < jumps + 2; i++) {
+                move->m[i] = m[i];
+            }
+        } else if(jumps == 0) {
+            return;
+        }
+        jumps--;
+        from = at[jumps];
+        captured ^= squarebit[m[2 + jumps] % 256];
+        if(jumps == 0) {
+            dirs = (piece & KING) ? firstdirs : dirs;
         }
     }
-    return(0);
 }
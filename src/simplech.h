@@ -14,6 +14,158 @@
 #define LOSS 2
 #define UNKNOWN 3
 
-void getmove(uint8_t b[8][8], uint8_t color, int *playnow);
+/* playable square index 0..31 of board[x][y] and back */
+#define SQ_INDEX(x, y) (((y) << 2) | ((x) >> 1))
+#define SQ_ROW(i)      ((i) >> 2)
+#define SQ_COL(i)      ((((i) & 3) << 1) | (((i) >> 2) & 1))
+/* ... and its number in the standard 1..32 notation, and back */
+#define SQ_NUMBER(i)   (((i) & ~3) + 4 - ((i) & 3))
+#define SQ_FROMNUMBER(n) ((((n) - 1) & ~3) + 3 - (((n) - 1) & 3))
+
+/* longest position in checkers fen, "B:W" then ",K32" per piece and ":B" */
+#define FENLENGTH 140
+/* longest move in notation, a capture of 12 pieces with every landing */
+#define MOVELENGTH 40
+
+/* compact move as kept in the game history, squares are SQ_INDEX numbers */
+typedef struct gamemove_struct {
+    uint8_t from;
+    uint8_t to;
+    uint8_t piece;     /* piece on from before the move */
+    uint8_t after;     /* piece on to after the move, differs on promotion */
+    uint32_t captured; /* one bit per jumped square */
+    uint32_t capkings; /* which of the jumped pieces were kings */
+} gamemove_t;
+
+/* set to 0 to compile the search statistics out */
+#ifndef SEARCH_STATS
+#define SEARCH_STATS 1
+#endif
+
+/* board backend of the engine: 0 for the cboard mailbox, 1 to keep */
+/* bitboards next to it for the move generator */
+#ifndef BOARD_BITBOARD
+#define BOARD_BITBOARD 0
+#endif
+
+/* 1 to generate moves with loops over the directions of the neighbor */
+/* and landing tables instead of the unrolled square offsets, see */
+/* simplech.c; the bitboard backend only uses them for captures */
+#ifndef MOVEGEN_TABLES
+#define MOVEGEN_TABLES 0
+#endif
+
+/* endgame database probes in the search, see egdb.h */
+#ifndef EGDB
+#define EGDB 1
+#endif
+
+/* most pieces on the board in an endgame table */
+#define EGDB_MAXPIECES 6
+
+/* opening book moves played without a search, see book.h */
+#ifndef BOOK
+#define BOOK 1
+#endif
+
+/* 1 to report the stack and heap high-water marks, see memprof.h */
+#ifndef MEMORY_PROFILE
+#define MEMORY_PROFILE 0
+#endif
+
+/* set to 1 in host tools that run several searches at once, each thread */
+/* then keeps the state of its search for itself, see tools/batch.c */
+#ifndef ENGINE_THREADS
+#define ENGINE_THREADS 0
+#endif
+#if ENGINE_THREADS
+#define THREADLOCAL _Thread_local
+#else
+#define THREADLOCAL
+#endif
+
+/* longest principal variation kept */
+#define MAXPV 8
+
+#if SEARCH_STATS
+/* statistics of the last getmove search, pv squares are in 1..32 notation */
+typedef struct searchstats_struct {
+    uint32_t nodes;
+    uint32_t leaves;       /* nodes ending in an evaluation */
+    uint32_t cutoffs;      /* nodes that failed high */
+    uint32_t firstcutoffs; /* ... on their first move */
+    uint32_t skipgen;      /* ... before their full move list was generated */
+    uint32_t tthits;       /* nodes whose best move table entry was playable */
+    uint32_t killerhits;   /* killer moves that were playable */
+    uint32_t reduced;      /* moves searched with a late move reduction */
+    uint32_t researched;   /* ... and again at full depth */
+    uint32_t evalhits;     /* leaves found in the evaluation cache */
+    uint32_t egdbhits;     /* nodes found in the endgame databases */
+    uint32_t time;         /* milliseconds */
+    int score;
+    uint16_t arenapeak;    /* most move arena slots in use */
+    uint8_t depth;
+    uint8_t seldepth;      /* deepest ply reached, capture extensions included */
+    uint8_t pvlength;
+    uint8_t pv[MAXPV][3];  /* from, to and 1 for a capture */
+} searchstats_t;
+
+extern THREADLOCAL searchstats_t searchstats;
+void printstats(void);
+void pvtonotation(int i, char *str);
+#endif
+
+/* most moves a multi-pv analysis keeps */
+#define MAXHINTS 4
+
+/* the best moves of a position, best first, from analyze() */
+typedef struct analysis_struct {
+    uint32_t hash;     /* position and side to move analysed */
+    uint8_t legal;     /* legal moves in the position */
+    uint8_t count;     /* moves in move[] */
+    uint8_t depth;     /* deepest search completed */
+    int score[MAXHINTS]; /* from the point of view of the side to move */
+    gamemove_t move[MAXHINTS];
+} analysis_t;
+
+/* plies without a capture or man move after which the game is a draw */
+extern int drawplies;
+
+/* nominal depth of the search, in plies */
+extern int searchdepth;
+
+/* difficulty levels of getmove, weakest first, see setlevel() */
+#define LEVELS 4
+
+/* states of a search run in slices */
+#define SEARCH_DONE 0
+#define SEARCH_RUNNING 1
+#define SEARCH_NOMOVE 2
+
+uint8_t getmove(uint8_t b[8][8], uint8_t color, int *playnow, gamemove_t *played);
+uint8_t searchstart(uint8_t b[8][8], uint8_t color, int *playnow);
+uint8_t searchrun(uint32_t nodes);
+uint8_t searchinfo(gamemove_t *best, uint8_t *spent);
+uint8_t searchresult(uint8_t b[8][8], gamemove_t *played);
+void searchstop(void);
+uint8_t analyze(uint8_t b[8][8], uint8_t color, uint8_t k, uint32_t ms, analysis_t *result);
+uint8_t setgamehistory(uint8_t b[8][8], uint8_t color, const gamemove_t *moves, uint16_t n);
+void makegamemove(uint8_t b[8][8], const gamemove_t *move);
+void unmakegamemove(uint8_t b[8][8], const gamemove_t *move);
+void setlevel(uint8_t level);
+void searchreset(void);
+uint8_t fentoboard(const char *fen, uint8_t b[8][8], uint8_t *color);
+void boardtofen(uint8_t b[8][8], uint8_t color, char *str);
+void gamemovetonotation(const gamemove_t *move, char *str);
+#if EGDB
+int egdbload(const char *dir, int maxpieces);
+#endif
+#if BOOK
+uint32_t bookload(const char *name);
+#endif
+#if MEMORY_PROFILE
+void memprofstart(void);
+void memprofreport(const char *when);
+#endif
 
 #endif
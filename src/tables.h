@@ -0,0 +1,79 @@
+/**
+ * read-only data tables used where they are stored, without copying them
+ * into RAM: the endgame databases now, an opening book or tuned weights
+ * later.
+ *
+ * on the calc a table is an appvar in the archive and tableopen() returns
+ * a pointer into flash. appvars in RAM are not opened, they move whenever
+ * another variable is created or deleted. the archive itself only moves
+ * when it is garbage collected, which archiving a variable can start, so
+ * nothing may be archived while a table is in use: main() archives the
+ * save only after the game loop.
+ *
+ * on the host a table is a file mapped with mmap(), shared between the
+ * processes that map it and paged in as it is read.
+ */
+
+#ifndef TABLES_H
+#define TABLES_H
+
+#ifdef HOST_BUILD
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/**
+ * maps the table name, a path on the host and an appvar name on the calc.
+ * returns its data and sets length to its size, or returns NULL
+ */
+const uint8_t *tableopen(const char *name, uint32_t *length) {
+#ifdef HOST_BUILD
+    struct stat st;
+    void *data;
+    int fd;
+
+    if((fd = open(name, O_RDONLY)) < 0) {
+        return(NULL);
+    }
+    if(fstat(fd, &st) != 0 || st.st_size <= 0 || (uint64_t)st.st_size > UINT32_MAX ||
+       (data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        close(fd);
+        return(NULL);
+    }
+    /* the mapping keeps the file */
+    close(fd);
+    *length = st.st_size;
+    return(data);
+#else
+    const uint8_t *data = NULL;
+    ti_var_t slot;
+
+    if((slot = ti_Open(name, "r")) == 0) {
+        return(NULL);
+    }
+    if(ti_IsArchived(slot)) {
+        data = ti_GetDataPtr(slot);
+        *length = ti_GetSize(slot);
+    }
+    /* the pointer stays good after the slot is closed */
+    ti_Close(slot);
+    return(data);
+#endif
+}
+
+/**
+ * gives back a table from tableopen() once it is no longer used
+ */
+void tableclose(const uint8_t *data, uint32_t length) {
+#ifdef HOST_BUILD
+    munmap((void *)data, length);
+#else
+    /* nothing was taken from the archive */
+    (void)data;
+    (void)length;
+#endif
+}
+
+#endif
@@ -0,0 +1,210 @@
+/**
+ * batch analysis of positions for host builds of the engine
+ *
+ *   make -C tools batch && tools/batch [-d depth | -n nodes] [-t threads] [-e egdbdir] [file]
+ *
+ * reads positions in checkers fen, one per line, from file or stdin as
+ * they come, and searches each to depth (default SEARCHDEPTH) or with a
+ * budget of nodes, on threads threads (default one per cpu). writes one
+ * line per position, in input order:
+ *
+ *   B:W18,24,K10:B12,16,K22 16-19 score 30 depth 6 nodes 1234
+ *
+ * the position written back as fen, then the best move, or none without
+ * one, and the search with the score from the side to move's point of
+ * view. positions with a single legal move are searched as well, and no
+ * book is loaded, so every score comes from a search. a line that is not
+ * a position is answered with the line and "error", blank lines are
+ * skipped. the number of positions and the positions per second go to
+ * stderr at the end.
+ *
+ * the engine is built with ENGINE_THREADS, so every thread searches with
+ * a board, tables and statistics of its own, and the endgame tables get
+ * a small block cache per thread. the tables are cleared before each
+ * position, which keeps the results independent of the number of
+ * threads. the engine source is included directly for that.
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+
+#define ENGINE_THREADS 1
+#define EGDB_CACHEBLOCKS 64
+#include "simplech.c"
+
+/* positions read ahead of the oldest one not written yet */
+#define RING 1024
+#define MAXLINE 256
+
+struct job {
+    char line[MAXLINE];
+    char result[FENLENGTH + MOVELENGTH + 64];
+    int bad;        /* longer than a line can be */
+    int done;
+};
+
+/* the ring holds the positions from tail, the oldest not written, to */
+/* head, the next one read; next is the next one a thread takes */
+static struct job ring[RING];
+static unsigned long head, next, tail;
+static int finished;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done = PTHREAD_COND_INITIALIZER;
+
+static void analyse(struct job *job) {
+    char fen[FENLENGTH];
+    char notation[MOVELENGTH];
+    uint8_t b[8][8];
+    uint8_t color;
+    gamemove_t move;
+    int playnow = 0;
+
+    if(job->bad || !fentoboard(job->line, b, &color)) {
+        size_t length = strlen(job->line) < FENLENGTH ? strlen(job->line) : FENLENGTH;
+
+        memcpy(job->result, job->line, length);
+        strcpy(job->result + length, " error");
+        return;
+    }
+    boardtofen(b, color, fen);
+    searchreset();
+    if(!getmove(b, color, &playnow, &move)) {
+        sprintf(job->result, "%s none", fen);
+        return;
+    }
+    gamemovetonotation(&move, notation);
+    sprintf(job->result, "%s %s score %d depth %d nodes %lu", fen, notation,
+            color == BLACK ? searchstats.score : -searchstats.score,
+            searchstats.depth, (unsigned long)searchstats.nodes);
+}
+
+static void *worker(void *unused) {
+    (void)unused;
+#if EGDB
+    egdbcache((uint32_t)EGDB_CACHEBLOCKS * EGDB_BLOCK);
+#endif
+    pthread_mutex_lock(&lock);
+    for(;;) {
+        struct job *job;
+
+        while(next == head && !finished) {
+            pthread_cond_wait(&work, &lock);
+        }
+        if(next == head) {
+            break;
+        }
+        job = &ring[next++ % RING];
+        pthread_mutex_unlock(&lock);
+        analyse(job);
+        pthread_mutex_lock(&lock);
+        job->done = 1;
+        pthread_cond_signal(&done);
+    }
+    pthread_mutex_unlock(&lock);
+    return(NULL);
+}
+
+/* reads the next line into the job, 0 at the end of the input */
+static int readline(FILE *in, struct job *job) {
+    size_t length;
+
+    if(fgets(job->line, MAXLINE, in) == NULL) {
+        return(0);
+    }
+    length = strlen(job->line);
+    job->bad = 0;
+    if(length > 0 && job->line[length - 1] != '\n' && !feof(in)) {
+        int c;
+
+        /* the rest of an overlong line is dropped */
+        while((c = fgetc(in)) != EOF && c != '\n');
+        job->bad = 1;
+    }
+    job->line[strcspn(job->line, "\r\n")] = '\0';
+    job->done = 0;
+    return(1);
+}
+
+int main(int argc, char **argv) {
+    pthread_t threads[256];
+    int nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *egdbdir = NULL;
+    FILE *in = stdin;
+    uint32_t start, time;
+    int c, i;
+
+    /* every line gets a searched score, forced moves too */
+    searchforced = 1;
+    while((c = getopt(argc, argv, "d:n:t:e:")) != -1) {
+        switch(c) {
+        case 'd': searchdepth = atoi(optarg); nodebudget = 0; break;
+        case 'n': nodebudget = strtoul(optarg, NULL, 10); break;
+        case 't': nthreads = atoi(optarg); break;
+        case 'e': egdbdir = optarg; break;
+        default:
+            fprintf(stderr, "usage: batch [-d depth | -n nodes] [-t threads] [-e egdbdir] [file]\n");
+            return 1;
+        }
+    }
+    if(optind < argc && (in = fopen(argv[optind], "r")) == NULL) {
+        perror(argv[optind]);
+        return 1;
+    }
+    if(nthreads < 1) {
+        nthreads = 1;
+    }
+    if(nthreads > 256) {
+        nthreads = 256;
+    }
+    /* the shared tables are filled before any thread needs them */
+    initzobrist();
+#if EGDB
+    if(egdbdir != NULL) {
+        fprintf(stderr, "batch egdb tables %d\n", egdbload(egdbdir, EGDB_MAXPIECES));
+    }
+#endif
+
+    start = monotonicms();
+    for(i = 0; i < nthreads; i++) {
+        pthread_create(&threads[i], NULL, worker, NULL);
+    }
+    pthread_mutex_lock(&lock);
+    for(;;) {
+        /* results go out as soon as all before them are out */
+        while(tail != head && ring[tail % RING].done) {
+            puts(ring[tail++ % RING].result);
+        }
+        if(!finished && head - tail < RING) {
+            struct job *job = &ring[head % RING];
+            int more;
+
+            /* the slot is free, no thread looks at it while the line is read */
+            fflush(stdout);
+            pthread_mutex_unlock(&lock);
+            while((more = readline(in, job)) && job->line[0] == '\0' && !job->bad);
+            pthread_mutex_lock(&lock);
+            if(more) {
+                head++;
+                pthread_cond_signal(&work);
+            } else {
+                finished = 1;
+                pthread_cond_broadcast(&work);
+            }
+            continue;
+        }
+        if(finished && tail == head) {
+            break;
+        }
+        pthread_cond_wait(&done, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+    for(i = 0; i < nthreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    fflush(stdout);
+    time = monotonicms() - start;
+    fprintf(stderr, "batch positions %lu threads %d time %lu positions/s %lu\n", head, nthreads,
+            (unsigned long)time, (unsigned long)(time ? (uint64_t)head * 1000 / time : head));
+    return 0;
+}
@@ -0,0 +1,89 @@
+/**
+ * search benchmark for host builds of the engine
+ *
+ *   make -C tools && tools/bench [depth [egdbdir]]
+ *
+ * lets the engine pick a move in each of a fixed set of positions and
+ * prints the statistics line of every search, followed by the totals.
+ * with egdbdir, the search probes the endgame tables found there (see
+ * tools/egdbgen.c). built as bench-memprof, every search and the end
+ * also report the stack and heap high-water marks, see memprof.h
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simplech.h"
+
+/* boards list the 32 playable squares in SQ_INDEX order */
+/* b/w is a black/white man, B/W a king and - an empty square */
+static const struct {
+    const char *board;
+    uint8_t color;
+} positions[] = {
+    { "bbbbbbbbbbbb--------wwwwwwwwwwww", BLACK },
+    { "bbbbbbbb-bbbb-------wwww-wwwwwww", BLACK },
+    { "bbbb-bbb-bbb-b----w--wwww-wwwwww", WHITE },
+    { "b-bbbb-bbb-b-bb--w-ww--ww-w-ww-w", BLACK },
+    { "----B-------w-w-----w-w---------", BLACK },
+    { "-b------w-w-w---w-w-w-----------", BLACK },
+    { "--b--b-b-B---b------w-W-w--w-w--", WHITE },
+    { "-----b-b----B-------W---w-w-----", BLACK },
+    { "b---------b-----W---w-------W---", BLACK },
+    { "B---B-----------------W-----W---", BLACK },
+};
+
+static void setboard(uint8_t b[8][8], const char *str) {
+    int i;
+
+    memset(b, 0, 64);
+    for(i = 0; i < 32; i++) {
+        uint8_t piece;
+        switch(str[i]) {
+        case 'b': piece = BLACK | MAN; break;
+        case 'w': piece = WHITE | MAN; break;
+        case 'B': piece = BLACK | KING; break;
+        case 'W': piece = WHITE | KING; break;
+        default:  piece = FREE; break;
+        }
+        b[SQ_COL(i)][SQ_ROW(i)] = piece;
+    }
+}
+
+int main(int argc, char **argv) {
+    uint8_t b[8][8];
+    gamemove_t move;
+    int playnow = 0;
+    unsigned i;
+    unsigned long nodes = 0, time = 0;
+
+#if MEMORY_PROFILE
+    memprofstart();
+#endif
+    if(argc > 1) {
+        searchdepth = atoi(argv[1]);
+    }
+#if EGDB
+    if(argc > 2) {
+        printf("egdb tables %d\n", egdbload(argv[2], EGDB_MAXPIECES));
+    }
+#endif
+
+    for(i = 0; i < sizeof(positions) / sizeof(positions[0]); i++) {
+        setboard(b, positions[i].board);
+        setgamehistory(b, positions[i].color, NULL, 0);
+        getmove(b, positions[i].color, &playnow, &move);
+#if SEARCH_STATS
+        printstats();
+        nodes += searchstats.nodes;
+        time += searchstats.time;
+#endif
+    }
+    printf("total nodes %lu time %lu nps %lu\n", nodes, time, time ? nodes * 1000 / time : 0);
+#if MEMORY_PROFILE
+    memprofreport("exit");
+#endif
+    return 0;
+}
@@ -0,0 +1,490 @@
+/**
+ * opening book builder for host builds of the engine
+ *
+ *   make -C tools bookgen && tools/bookgen [-t threads] [-p plies] [-f games]
+ *       [-w window] [-m entries] [-s games [-n nodes] [-r plies]] [-o file]
+ *       [archive.pdn ...]
+ *
+ * counts, for the first plies plies (default 16) of every game, how often
+ * each move was played in each position and how it scored for the side
+ * that played it, a win 2 points, a draw 1 and a loss 0. the games come
+ * from the pdn archives, read with pdn.h, and from games games of self
+ * play, which start with plies random plies (default 4) and go on with
+ * the engine at a budget of nodes nodes a move (default 3000). games
+ * without a result and games with an error are left out.
+ *
+ * a move goes into the book if it was played in at least games games
+ * (default 4) and scored no more than window percent (default 10) below
+ * the best such move of its position. its weight is the number of games
+ * times its score in percent, divided by 100, so a probe prefers moves
+ * that are both played and good. with -m only the entries heaviest
+ * entries are kept, 8000 fit in an appvar. the book, in the format of
+ * src/book.h, goes to file (default book.bok).
+ *
+ * threads threads (default one per cpu) share the work: each archive is
+ * cut into one part per thread at game boundaries, lines starting with
+ * a tag after a line that is not one, and self-play games are handed out
+ * one at a time. all threads count into one hash map cut into SHARDS
+ * shards with a lock each. a self-play game only depends on its number,
+ * so the book does not depend on the number of threads. the engine
+ * source is included directly for ENGINE_THREADS and the move generator.
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define ENGINE_THREADS 1
+#include "simplech.c"
+#include "pdn.h"
+
+/* shards of the hash map, by the top bits of the position hash */
+#define SHARDS 256
+#define SHARDSLOTS 1024
+
+/* longest self-play game, a draw when it gets there */
+#define MAXGAME 300
+
+/* a move played in a position */
+struct bookstat {
+    uint32_t hash;
+    uint8_t from;
+    uint8_t to;
+    uint8_t used;
+    uint8_t score;     /* percent, while the book is written */
+    uint32_t games;
+    uint32_t points;
+};
+
+struct shard {
+    pthread_mutex_t lock;
+    struct bookstat *slots;
+    uint32_t size;     /* a power of two */
+    uint32_t count;
+};
+
+/* a byte range of an archive, from the first game at start to the first at end */
+struct part {
+    const char *path;
+    off_t start;
+    off_t end;
+    unsigned long games;
+    unsigned long errors;
+};
+
+static struct shard shards[SHARDS];
+
+static int bookplies = 16;
+static uint32_t mingames = 4;
+static int window = 10;
+static int randomplies = 4;
+static unsigned long selfgames;
+static unsigned long nextgame;
+static unsigned long selfresults[4];
+static pthread_mutex_t gamelock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t slotindex(uint32_t hash, uint8_t from, uint8_t to, uint32_t size) {
+    return((hash ^ (uint32_t)(from << 5 | to) * 0x9E3779B9u) & (size - 1));
+}
+
+/* adds a game with points for the side that played from to in the position */
+static void record(uint32_t hash, uint8_t from, uint8_t to, uint32_t points) {
+    struct shard *shard = &shards[hash >> 24];
+    struct bookstat *slot;
+    uint32_t i;
+
+    pthread_mutex_lock(&shard->lock);
+    if(shard->count * 2 >= shard->size) {
+        struct bookstat *old = shard->slots;
+        uint32_t size = shard->size;
+
+        shard->size = size ? size * 2 : SHARDSLOTS;
+        if((shard->slots = calloc(shard->size, sizeof(struct bookstat))) == NULL) {
+            fprintf(stderr, "bookgen out of memory\n");
+            exit(1);
+        }
+        for(i = 0; i < size; i++) {
+            if(old[i].used) {
+                uint32_t j = slotindex(old[i].hash, old[i].from, old[i].to, shard->size);
+
+                while(shard->slots[j].used) {
+                    j = (j + 1) & (shard->size - 1);
+                }
+                shard->slots[j] = old[i];
+            }
+        }
+        free(old);
+    }
+    for(i = slotindex(hash, from, to, shard->size);; i = (i + 1) & (shard->size - 1)) {
+        slot = &shard->slots[i];
+        if(!slot->used) {
+            slot->used = 1;
+            slot->hash = hash;
+            slot->from = from;
+            slot->to = to;
+            shard->count++;
+            break;
+        }
+        if(slot->hash == hash && slot->from == from && slot->to == to) {
+            break;
+        }
+    }
+    slot->games++;
+    slot->points += points;
+    pthread_mutex_unlock(&shard->lock);
+}
+
+/* counts the first bookplies plies of a game, result for black */
+static void addgame(uint8_t start[8][8], uint8_t color, const gamemove_t *moves, int plies, uint8_t result) {
+    uint8_t b[8][8];
+    int i;
+
+    if(result == UNKNOWN) {
+        return;
+    }
+    memcpy(b, start, sizeof(b));
+    for(i = 0; i < plies && i < bookplies; i++) {
+        uint32_t points = result == DRAW ? 1 : (result == WIN) == (color == BLACK) ? 2 : 0;
+
+        record(hashboard(b, color), moves[i].from, moves[i].to, points);
+        makegamemove(b, &moves[i]);
+        color ^= CHANGECOLOR;
+    }
+}
+
+static void startboard(uint8_t b[8][8]) {
+    int i;
+
+    memset(b, 0, 64);
+    for(i = 0; i < 32; i++) {
+        b[SQ_COL(i)][SQ_ROW(i)] = i < 12 ? (BLACK | MAN) : i >= 20 ? (WHITE | MAN) : FREE;
+    }
+}
+
+/**
+ * plays self-play game number, random first plies from a generator
+ * seeded with the number, and returns its result for black
+ */
+static uint8_t selfplay(unsigned long number, gamemove_t *moves, int *plies) {
+    struct move2 movelist[MAXMOVES];
+    uint8_t b[8][8];
+    uint8_t color = BLACK;
+    uint32_t seed = (uint32_t)number * 2654435761u + 1;
+    int playnow = 0;
+    int n;
+
+    startboard(b);
+    searchreset();
+    for(*plies = 0; *plies < MAXGAME; (*plies)++, color ^= CHANGECOLOR) {
+        if(setgamehistory(b, color, moves, *plies) == DRAW) {
+            return(DRAW);
+        }
+        if(*plies >= randomplies) {
+            if(!getmove(b, color, &playnow, &moves[*plies])) {
+                return(color == BLACK ? LOSS : WIN);
+            }
+            continue;
+        }
+        setupboard(b, color);
+        if((n = generatecapturelist(movelist, color)) == 0) {
+            n = generatemovelist(movelist, color);
+        }
+        if(n == 0) {
+            return(color == BLACK ? LOSS : WIN);
+        }
+        /* xorshift, the same game on any thread */
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        packmove(&movelist[seed % n], &moves[*plies]);
+        makegamemove(b, &moves[*plies]);
+    }
+    return(DRAW);
+}
+
+static void *selfplayer(void *unused) {
+    static THREADLOCAL gamemove_t moves[MAXGAME];
+
+    (void)unused;
+    for(;;) {
+        uint8_t start[8][8];
+        unsigned long number;
+        uint8_t result;
+        int plies;
+
+        pthread_mutex_lock(&gamelock);
+        number = nextgame++;
+        pthread_mutex_unlock(&gamelock);
+        if(number >= selfgames) {
+            break;
+        }
+        result = selfplay(number, moves, &plies);
+        startboard(start);
+        addgame(start, BLACK, moves, plies, result);
+        pthread_mutex_lock(&gamelock);
+        selfresults[result]++;
+        pthread_mutex_unlock(&gamelock);
+    }
+    return(NULL);
+}
+
+static void *readpart(void *arg) {
+    struct part *part = arg;
+    struct pdnreader *reader = malloc(sizeof(struct pdnreader));
+    struct pdngame *game = malloc(sizeof(struct pdngame));
+    FILE *in;
+
+    if(reader == NULL || game == NULL || (in = fopen(part->path, "rb")) == NULL ||
+       fseeko(in, part->start, SEEK_SET) != 0) {
+        fprintf(stderr, "bookgen can't read %s\n", part->path);
+        exit(1);
+    }
+    pdnopen(reader, in);
+    while(pdnread(reader, game) && part->start + (off_t)game->offset < part->end) {
+        if(game->error != PDN_OK) {
+            part->errors++;
+            continue;
+        }
+        if(game->plies != 0 && game->result != UNKNOWN) {
+            part->games++;
+            addgame(game->start, game->color, game->moves, game->plies, game->result);
+        }
+    }
+    fclose(in);
+    free(game);
+    free(reader);
+    return(NULL);
+}
+
+/**
+ * the offset of the first game of the archive in at offset or after it:
+ * the first line that starts with a tag after a line, blank ones left
+ * out, that does not. size, the end of the archive, if there is none
+ */
+static off_t gamestart(FILE *in, off_t offset, off_t size) {
+    int prevtag = 1; /* the line offset is in is not known */
+    int c;
+
+    if(offset == 0) {
+        return(0);
+    }
+    fseeko(in, offset - 1, SEEK_SET);
+    while((c = getc(in)) != EOF && c != '\n');
+    for(;;) {
+        off_t line = ftello(in);
+        int tag, blank = 1;
+
+        if((c = getc(in)) == EOF) {
+            return(size);
+        }
+        if(c == '[' && !prevtag) {
+            return(line);
+        }
+        tag = c == '[';
+        for(; c != EOF && c != '\n'; c = getc(in)) {
+            if(c != ' ' && c != '\t' && c != '\r') {
+                blank = 0;
+            }
+        }
+        if(!blank) {
+            prevtag = tag;
+        }
+    }
+}
+
+/* reads an archive into the map with nthreads threads */
+static void readarchive(const char *path, int nthreads, pthread_t *threads, unsigned long *games,
+                        unsigned long *errors) {
+    struct part parts[256];
+    struct stat st;
+    FILE *in;
+    int i;
+
+    if((in = fopen(path, "rb")) == NULL || fstat(fileno(in), &st) != 0) {
+        perror(path);
+        exit(1);
+    }
+    for(i = 0; i < nthreads; i++) {
+        parts[i].path = path;
+        parts[i].start = gamestart(in, st.st_size / nthreads * i, st.st_size);
+        if(i > 0 && parts[i].start < parts[i - 1].start) {
+            parts[i].start = parts[i - 1].start;
+        }
+        parts[i].games = parts[i].errors = 0;
+    }
+    fclose(in);
+    for(i = 0; i < nthreads; i++) {
+        parts[i].end = i + 1 < nthreads ? parts[i + 1].start : st.st_size;
+        pthread_create(&threads[i], NULL, readpart, &parts[i]);
+    }
+    for(i = 0; i < nthreads; i++) {
+        pthread_join(threads[i], NULL);
+        *games += parts[i].games;
+        *errors += parts[i].errors;
+    }
+}
+
+/* the moves of a position, heaviest first, then by squares */
+static int bymove(const struct bookstat *x, const struct bookstat *y) {
+    if(x->games != y->games) {
+        return(x->games < y->games ? 1 : -1);
+    }
+    return((x->from << 8 | x->to) - (y->from << 8 | y->to));
+}
+
+static int byhash(const void *a, const void *b) {
+    const struct bookstat *x = a, *y = b;
+
+    if(x->hash != y->hash) {
+        return(x->hash < y->hash ? -1 : 1);
+    }
+    return(bymove(x, y));
+}
+
+static int byweight(const void *a, const void *b) {
+    const struct bookstat *x = a, *y = b;
+
+    if(x->games != y->games) {
+        return(x->games < y->games ? 1 : -1);
+    }
+    if(x->hash != y->hash) {
+        return(x->hash < y->hash ? -1 : 1);
+    }
+    return(bymove(x, y));
+}
+
+static void write32(FILE *out, uint32_t value) {
+    putc(value & 255, out);
+    putc(value >> 8 & 255, out);
+    putc(value >> 16 & 255, out);
+    putc(value >> 24, out);
+}
+
+int main(int argc, char **argv) {
+    pthread_t threads[256];
+    int nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *output = BOOK_NAME;
+    unsigned long games = 0, errors = 0, maxentries = 0;
+    unsigned long total = 0, moves = 0, kept = 0;
+    struct bookstat *all;
+    uint32_t start, time;
+    FILE *out;
+    int c, i;
+
+    nodebudget = 3000;
+    while((c = getopt(argc, argv, "t:p:f:w:m:s:n:r:o:")) != -1) {
+        switch(c) {
+        case 't': nthreads = atoi(optarg); break;
+        case 'p': bookplies = atoi(optarg); break;
+        case 'f': mingames = strtoul(optarg, NULL, 10); break;
+        case 'w': window = atoi(optarg); break;
+        case 'm': maxentries = strtoul(optarg, NULL, 10); break;
+        case 's': selfgames = strtoul(optarg, NULL, 10); break;
+        case 'n': nodebudget = strtoul(optarg, NULL, 10); break;
+        case 'r': randomplies = atoi(optarg); break;
+        case 'o': output = optarg; break;
+        default:
+            fprintf(stderr, "usage: bookgen [-t threads] [-p plies] [-f games] [-w window] [-m entries]\n"
+                            "               [-s games [-n nodes] [-r plies]] [-o file] [archive.pdn ...]\n");
+            return 1;
+        }
+    }
+    if(nthreads < 1) {
+        nthreads = 1;
+    }
+    if(nthreads > 256) {
+        nthreads = 256;
+    }
+    if(mingames < 1) {
+        mingames = 1;
+    }
+    for(i = 0; i < SHARDS; i++) {
+        pthread_mutex_init(&shards[i].lock, NULL);
+    }
+    /* the shared tables are filled before any thread needs them */
+    initzobrist();
+
+    start = monotonicms();
+    for(i = optind; i < argc; i++) {
+        readarchive(argv[i], nthreads, threads, &games, &errors);
+    }
+    if(selfgames != 0) {
+        for(i = 0; i < nthreads; i++) {
+            pthread_create(&threads[i], NULL, selfplayer, NULL);
+        }
+        for(i = 0; i < nthreads; i++) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    /* gather the map, then prune each position's moves */
+    for(i = 0; i < SHARDS; i++) {
+        moves += shards[i].count;
+    }
+    if((all = malloc((moves ? moves : 1) * sizeof(struct bookstat))) == NULL) {
+        fprintf(stderr, "bookgen out of memory\n");
+        return 1;
+    }
+    for(i = 0; i < SHARDS; i++) {
+        uint32_t j;
+
+        for(j = 0; j < shards[i].size; j++) {
+            if(shards[i].slots[j].used) {
+                all[total++] = shards[i].slots[j];
+            }
+        }
+        free(shards[i].slots);
+    }
+    qsort(all, total, sizeof(struct bookstat), byhash);
+    for(moves = 0; moves < total;) {
+        unsigned long first = moves, j;
+        int best = -1;
+
+        for(; moves < total && all[moves].hash == all[first].hash; moves++) {
+            all[moves].score = (uint8_t)((uint64_t)all[moves].points * 50 / all[moves].games);
+            if(all[moves].games >= mingames && all[moves].score > best) {
+                best = all[moves].score;
+            }
+        }
+        for(j = first; j < moves; j++) {
+            if(all[j].games >= mingames && all[j].score + window >= best) {
+                uint32_t weight = (uint32_t)((uint64_t)all[j].games * all[j].score / 100);
+
+                all[kept] = all[j];
+                all[kept++].games = weight < 1 ? 1 : weight > 65535 ? 65535 : weight;
+            }
+        }
+    }
+    /* the weight is kept in games from here on */
+    if(maxentries != 0 && kept > maxentries) {
+        qsort(all, kept, sizeof(struct bookstat), byweight);
+        kept = maxentries;
+    }
+    qsort(all, kept, sizeof(struct bookstat), byhash);
+
+    if((out = fopen(output, "wb")) == NULL) {
+        perror(output);
+        return 1;
+    }
+    fwrite("BOK", 1, 3, out);
+    putc(BOOK_VERSION, out);
+    write32(out, kept);
+    for(moves = 0; moves < kept; moves++) {
+        write32(out, all[moves].hash);
+        putc(all[moves].from, out);
+        putc(all[moves].to, out);
+        putc(all[moves].games & 255, out);
+        putc(all[moves].games >> 8, out);
+    }
+    if(fclose(out) != 0) {
+        perror(output);
+        return 1;
+    }
+    time = monotonicms() - start;
+    fprintf(stderr, "bookgen archive games %lu errors %lu selfplay games %lu wins %lu draws %lu losses %lu\n",
+            games, errors, selfgames, selfresults[WIN], selfresults[DRAW], selfresults[LOSS]);
+    fprintf(stderr, "bookgen moves %lu entries %lu threads %d time %lu\n", total, kept, nthreads,
+            (unsigned long)time);
+    free(all);
+    return 0;
+}
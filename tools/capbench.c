@@ -0,0 +1,69 @@
+/**
+ * capture generation microbenchmark for host builds of the engine
+ *
+ *   make -C tools && tools/capbench
+ *
+ * the engine source is included directly so its internal move generator
+ * can be timed on positions full of multi-jumps
+ */
+
+#include "simplech.c"
+
+#define ROUNDS 200000
+
+/* boards list the 32 playable squares in SQ_INDEX order, as in bench.c */
+static const struct {
+    const char *board;
+    uint8_t color;
+} positions[] = {
+    { "----www--w--www-----ww--BwB-----", BLACK },
+    { "---------wwBB--w-www----www--B--", BLACK },
+    { "-----wwwBw--wwwww-w-wwww--B----w", BLACK },
+    { "----w-w-B--wwww-w-w-wwwwB---ww--", BLACK },
+    { "-----wwww-w-www-B----www--w--ww-", BLACK },
+    { "-----WbW--bb-----bbb--b--bbb----", WHITE },
+    { "--W--bbb----bbb-b--WWbb---------", WHITE },
+};
+
+static void setcboard(const char *str) {
+    int i;
+
+    for(i = 0; i < 46; i++) {
+        cboard[i] = OCCUPIED;
+    }
+    for(i = 0; i < 32; i++) {
+        uint8_t piece;
+        switch(str[i]) {
+        case 'b': piece = BLACK | MAN; break;
+        case 'w': piece = WHITE | MAN; break;
+        case 'B': piece = BLACK | KING; break;
+        case 'W': piece = WHITE | KING; break;
+        default:  piece = FREE; break;
+        }
+        cboard[i + 5 + (i + 4) / 8] = piece;
+    }
+    loadboard();
+}
+
+int main(void) {
+    static struct move2 movelist[MAXMOVES];
+    unsigned i;
+    long r;
+    unsigned long total = 0;
+    uint32_t start, time;
+
+    for(i = 0; i < sizeof(positions) / sizeof(positions[0]); i++) {
+        unsigned long sequences = 0;
+        setcboard(positions[i].board);
+        start = monotonicms();
+        for(r = 0; r < ROUNDS; r++) {
+            sequences += generatecapturelist(movelist, positions[i].color);
+        }
+        time = monotonicms() - start;
+        total += time;
+        printf("capbench position %u sequences %lu time %lu ns/call %lu\n", i,
+               sequences / ROUNDS, (unsigned long)time, (unsigned long)time * 1000000 / ROUNDS);
+    }
+    printf("capbench total time %lu\n", total);
+    return 0;
+}
@@ -0,0 +1,597 @@
+/**
+ * endgame database generator for host builds of the engine
+ *
+ *   make -C tools egdbgen && tools/egdbgen [pieces [threads [dir]]]
+ *
+ * solves every slice of 2 to pieces pieces (default 4, at most
+ * EGDB_MAXPIECES) with threads threads (default one per cpu) and
+ * writes the tables to dir (default .). see src/egdb.h for the index
+ * and the file format. a slice whose table is already in dir is loaded
+ * instead of solved again, so an interrupted run picks up where it
+ * stopped.
+ *
+ * the moves of a slice lead into three kinds of slices: captures into
+ * one with fewer pieces, promotions into one with fewer men, and all
+ * other moves into its own slice turned around for the other side. the
+ * slices are therefore solved by piece count, then by number of men,
+ * and a slice together with its turned around partner.
+ *
+ * a pair is solved backwards from the lost positions. the first pass
+ * looks at every position: one with a move into a lost position is won,
+ * one with all moves into won positions is lost, and one without moves
+ * is lost. every position a pass decides marks the positions that lead
+ * to it by a quiet move, found by taking the move back, and the next
+ * pass only looks at the marked ones. the threads share each pass in
+ * chunks of the index. when a pass decides nothing, the positions left
+ * are draws.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include "simplech.h"
+#include "egdb.h"
+
+/* positions a thread takes from a pass at a time */
+#define CHUNK 4096
+
+/* the mark of a position to look at in pass p */
+#define MARK(p) (4 << ((p) & 1))
+
+/* most successors of a position of EGDB_MAXPIECES pieces */
+#define MAXSUCCESSORS 64
+
+/* neighbour and jump target of each square in the four directions, */
+/* the first two towards row 7, -1 off the board */
+static int step[32][4];
+static int jump[32][4];
+
+/* the tables solved or loaded so far, by signature */
+static const uint8_t *tables[EGDB_MAXPIECES + 1][EGDB_MAXPIECES + 1][EGDB_MAXPIECES + 1][EGDB_MAXPIECES + 1];
+
+/* the one or two slices of the current pass, a byte per position: the */
+/* value in the low two bits, and the mark of an even or odd pass */
+struct work {
+    uint8_t pieces[4];
+    uint32_t size;
+    uint8_t *values;
+};
+
+static struct work pair[2];
+static int pairs;
+static int passes;
+static uint32_t nextchunk;
+static uint32_t changed;
+
+/* sizes of the tables unpacked and in their files */
+static unsigned long packedbytes;
+static unsigned long filebytes;
+
+struct successors {
+    struct egdbposition pos[MAXSUCCESSORS];
+    int n;
+};
+
+static double seconds(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void initsquares(void) {
+    static const int drow[4] = {1, 1, -1, -1};
+    static const int dcol[4] = {-1, 1, -1, 1};
+    int i, d;
+
+    for(i = 0; i < 32; i++) {
+        for(d = 0; d < 4; d++) {
+            int row = SQ_ROW(i) + drow[d], col = SQ_COL(i) + dcol[d];
+
+            step[i][d] = row >= 0 && row < 8 && col >= 0 && col < 8 ? SQ_INDEX(col, row) : -1;
+            row += drow[d];
+            col += dcol[d];
+            jump[i][d] = row >= 0 && row < 8 && col >= 0 && col < 8 ? SQ_INDEX(col, row) : -1;
+        }
+    }
+}
+
+/* the set of k squares with the given rank, inverse of egdbrank() */
+static uint32_t unrank(uint32_t rank, int k, uint32_t skip, int first) {
+    uint32_t set = 0;
+
+    for(; k > 0; k--) {
+        int p = k - 1, square, free;
+
+        while(binomial[p + 1][k] <= rank) {
+            p++;
+        }
+        rank -= binomial[p][k];
+        /* the p-th square from first that is not in skip */
+        for(square = first, free = -1; ; square++) {
+            if(!(skip & ((uint32_t)1 << square)) && ++free == p) {
+                break;
+            }
+        }
+        set |= (uint32_t)1 << square;
+    }
+    return(set);
+}
+
+/* the position at index of a slice, 0 for an index whose men overlap */
+static int position(struct egdbposition *pos, const uint8_t pieces[4], uint32_t index) {
+    int free = 32 - pieces[0] - pieces[2];
+    uint32_t kingsets = binomial[free][pieces[1]] * binomial[free - pieces[1]][pieces[3]];
+    uint32_t men = index / kingsets;
+    uint32_t kings = index % kingsets;
+
+    pos->blackmen = unrank(men / binomial[28][pieces[2]], pieces[0], 0, 0);
+    pos->whitemen = unrank(men % binomial[28][pieces[2]], pieces[2], 0, 4);
+    if(pos->blackmen & pos->whitemen) {
+        return(0);
+    }
+    men = pos->blackmen | pos->whitemen;
+    pos->blackkings = unrank(kings / binomial[free - pieces[1]][pieces[3]], pieces[1], men, 0);
+    pos->whitekings = unrank(kings % binomial[free - pieces[1]][pieces[3]], pieces[3], men | pos->blackkings, 0);
+    return(1);
+}
+
+/* adds the position after black's move, turned around for white to move */
+static void addsuccessor(struct successors *s, uint32_t men, uint32_t kings, uint32_t whitemen, uint32_t whitekings) {
+    struct egdbposition *pos = &s->pos[s->n++];
+
+    pos->blackmen = men;
+    pos->blackkings = kings;
+    pos->whitemen = whitemen;
+    pos->whitekings = whitekings;
+    egdbmirror(pos);
+}
+
+/* all jump sequences of the black piece on square, captured pieces leave the board at once */
+static void jumps(struct successors *s, const struct egdbposition *pos, int square, int king,
+                  uint32_t whitemen, uint32_t whitekings, uint32_t others, int jumped) {
+    int d, found = 0;
+
+    for(d = 0; d < (king ? 4 : 2); d++) {
+        int over = step[square][d], to = jump[square][d];
+        uint32_t overbit, tobit;
+
+        if(to < 0) {
+            continue;
+        }
+        overbit = (uint32_t)1 << over;
+        tobit = (uint32_t)1 << to;
+        if(!((whitemen | whitekings) & overbit) || ((whitemen | whitekings | others) & tobit)) {
+            continue;
+        }
+        found = 1;
+        if(!king && to >= 28) {
+            /* a man that reaches the last row is crowned and stops */
+            addsuccessor(s, pos->blackmen & others, (pos->blackkings & others) | tobit,
+                         whitemen & ~overbit, whitekings & ~overbit);
+        } else {
+            jumps(s, pos, to, king, whitemen & ~overbit, whitekings & ~overbit, others, 1);
+        }
+    }
+    if(!found && jumped) {
+        uint32_t bit = (uint32_t)1 << square;
+
+        addsuccessor(s, (pos->blackmen & others) | (king ? 0 : bit), (pos->blackkings & others) | (king ? bit : 0),
+                     whitemen, whitekings);
+    }
+}
+
+/* the positions black's moves lead to, captures are compulsory */
+static void successors(struct successors *s, const struct egdbposition *pos) {
+    uint32_t black = pos->blackmen | pos->blackkings;
+    uint32_t empty = ~(black | pos->whitemen | pos->whitekings);
+    uint32_t set;
+    int square, d;
+
+    s->n = 0;
+    for(set = black; set != 0; set &= set - 1) {
+        uint32_t bit = set & -set;
+
+        for(square = 0; !(bit & ((uint32_t)1 << square)); square++);
+        jumps(s, pos, square, (pos->blackkings & bit) != 0, pos->whitemen, pos->whitekings, black & ~bit, 0);
+    }
+    if(s->n != 0) {
+        return;
+    }
+    for(set = black; set != 0; set &= set - 1) {
+        uint32_t bit = set & -set;
+        int king = (pos->blackkings & bit) != 0;
+
+        for(square = 0; !(bit & ((uint32_t)1 << square)); square++);
+        for(d = 0; d < (king ? 4 : 2); d++) {
+            int to = step[square][d];
+            uint32_t tobit;
+
+            if(to < 0 || !(empty & ((uint32_t)1 << to))) {
+                continue;
+            }
+            tobit = (uint32_t)1 << to;
+            if(king) {
+                addsuccessor(s, pos->blackmen, (pos->blackkings & ~bit) | tobit, pos->whitemen, pos->whitekings);
+            } else if(to >= 28) {
+                addsuccessor(s, pos->blackmen & ~bit, pos->blackkings | tobit, pos->whitemen, pos->whitekings);
+            } else {
+                addsuccessor(s, (pos->blackmen & ~bit) | tobit, pos->blackkings, pos->whitemen, pos->whitekings);
+            }
+        }
+    }
+}
+
+/* value of a successor, from the current pair or a table solved before */
+static int lookup(const struct egdbposition *pos) {
+    uint8_t pieces[4];
+    const uint8_t *table;
+    int i;
+
+    pieces[0] = egdbsquares(pos->blackmen);
+    pieces[1] = egdbsquares(pos->blackkings);
+    pieces[2] = egdbsquares(pos->whitemen);
+    pieces[3] = egdbsquares(pos->whitekings);
+    if(pieces[0] + pieces[1] == 0) {
+        return(LOSS);
+    }
+    if(pieces[2] + pieces[3] == 0) {
+        return(WIN);
+    }
+    for(i = 0; i < pairs; i++) {
+        if(memcmp(pieces, pair[i].pieces, 4) == 0) {
+            return(__atomic_load_n(&pair[i].values[egdbindex(pos, pieces)], __ATOMIC_RELAXED) & 3);
+        }
+    }
+    table = tables[pieces[0]][pieces[1]][pieces[2]][pieces[3]];
+    if(table == NULL) {
+        fprintf(stderr, "egdbgen: E%d%d%d%d needed before it was solved\n", pieces[0], pieces[1], pieces[2], pieces[3]);
+        exit(1);
+    }
+    return(egdbvalue(table, egdbindex(pos, pieces)));
+}
+
+/* what the successors tell about a position so far */
+static int solve(const struct egdbposition *pos) {
+    struct successors s;
+    int allwon = 1;
+    int i;
+
+    successors(&s, pos);
+    for(i = 0; i < s.n; i++) {
+        int value = lookup(&s.pos[i]);
+
+        if(value == LOSS) {
+            return(WIN);
+        }
+        if(value != WIN) {
+            allwon = 0;
+        }
+    }
+    return(allwon ? LOSS : UNKNOWN);
+}
+
+/* marks the positions whose quiet moves lead to the decided one for the next pass */
+static void markpredecessors(const struct egdbposition *decided) {
+    struct egdbposition moved = *decided;
+    uint32_t empty, set;
+    int square, d, i;
+
+    /* the side that just moved is black again */
+    egdbmirror(&moved);
+    empty = ~(moved.blackmen | moved.blackkings | moved.whitemen | moved.whitekings);
+    for(set = moved.blackmen | moved.blackkings; set != 0; set &= set - 1) {
+        uint32_t bit = set & -set;
+        int king = (moved.blackkings & bit) != 0;
+
+        for(square = 0; !(bit & ((uint32_t)1 << square)); square++);
+        /* a man came from the row behind, a king from anywhere around */
+        for(d = king ? 0 : 2; d < 4; d++) {
+            int from = step[square][d];
+            struct egdbposition before = moved;
+            uint8_t pieces[4];
+
+            if(from < 0 || !(empty & ((uint32_t)1 << from))) {
+                continue;
+            }
+            if(king) {
+                before.blackkings ^= bit | ((uint32_t)1 << from);
+            } else {
+                before.blackmen ^= bit | ((uint32_t)1 << from);
+            }
+            pieces[0] = egdbsquares(before.blackmen);
+            pieces[1] = egdbsquares(before.blackkings);
+            pieces[2] = egdbsquares(before.whitemen);
+            pieces[3] = egdbsquares(before.whitekings);
+            for(i = 0; i < pairs; i++) {
+                if(memcmp(pieces, pair[i].pieces, 4) == 0) {
+                    __atomic_fetch_or(&pair[i].values[egdbindex(&before, pieces)], MARK(passes + 1), __ATOMIC_RELAXED);
+                }
+            }
+        }
+    }
+}
+
+/* one thread's share of a pass */
+static void *pass(void *unused) {
+    uint32_t total = pair[0].size + (pairs > 1 ? pair[1].size : 0);
+    uint32_t found = 0;
+
+    (void)unused;
+    for(;;) {
+        uint32_t start = __atomic_fetch_add(&nextchunk, CHUNK, __ATOMIC_RELAXED);
+        uint32_t i;
+
+        if(start >= total) {
+            break;
+        }
+        for(i = start; i < start + CHUNK && i < total; i++) {
+            struct work *w = i < pair[0].size ? &pair[0] : &pair[1];
+            uint32_t index = i < pair[0].size ? i : i - pair[0].size;
+            struct egdbposition pos;
+            int value;
+
+            uint8_t *entry = &w->values[index];
+
+            if(passes != 0) {
+                if(!(__atomic_load_n(entry, __ATOMIC_RELAXED) & MARK(passes))) {
+                    continue;
+                }
+                __atomic_fetch_and(entry, ~MARK(passes), __ATOMIC_RELAXED);
+            }
+            if((__atomic_load_n(entry, __ATOMIC_RELAXED) & 3) != UNKNOWN) {
+                continue;
+            }
+            if(!position(&pos, w->pieces, index)) {
+                /* not a position, never looked up */
+                __atomic_fetch_and(entry, ~3, __ATOMIC_RELAXED);
+                continue;
+            }
+            if((value = solve(&pos)) == UNKNOWN) {
+                continue;
+            }
+            /* UNKNOWN has both value bits set, clear the ones value lacks */
+            __atomic_fetch_and(entry, ~(UNKNOWN ^ value), __ATOMIC_RELAXED);
+            markpredecessors(&pos);
+            found++;
+        }
+    }
+    __atomic_fetch_add(&changed, found, __ATOMIC_RELAXED);
+    return(NULL);
+}
+
+/* compresses a block of packed bytes into out, returns the compressed length */
+static uint32_t compress(const uint8_t *in, uint32_t n, uint8_t *out) {
+    uint32_t i = 0, length = 0;
+
+    while(i < n) {
+        uint32_t run = 1;
+
+        while(i + run < n && run < 257 && in[i + run] == in[i]) {
+            run++;
+        }
+        if(run >= 3 && (in[i] == 0 || in[i] == 121 || in[i] == 242)) {
+            out[length++] = EGDB_RUN + in[i] / 121;
+            out[length++] = run - 2;
+            i += run;
+        } else {
+            out[length++] = in[i++];
+        }
+    }
+    return(length);
+}
+
+static void put32(uint8_t *p, uint32_t n) {
+    p[0] = n;
+    p[1] = n >> 8;
+    p[2] = n >> 16;
+    p[3] = n >> 24;
+}
+
+/* packs a solved slice five values to a byte, writes it to dir in blocks */
+/* and returns the packed values */
+static const uint8_t *store(const struct work *w, const char *dir) {
+    uint32_t bytes = egdbbytes(w->size);
+    uint32_t blocks = (bytes + EGDB_BLOCK - 1) / EGDB_BLOCK;
+    uint32_t head = EGDB_HEADER + 4 * (blocks + 1);
+    uint8_t *data = calloc(bytes, 1);
+    uint8_t *file = malloc(head + bytes);
+    uint32_t length = 0;
+    char name[512];
+    FILE *out;
+    uint32_t i;
+
+    if(data == NULL || file == NULL) {
+        fprintf(stderr, "egdbgen: out of memory\n");
+        exit(1);
+    }
+    for(i = w->size; i-- > 0;) {
+        data[i / 5] = data[i / 5] * 3 + w->values[i];
+    }
+    memcpy(file, "WLD", 3);
+    file[3] = EGDB_VERSION;
+    memcpy(file + 4, w->pieces, 4);
+    put32(file + 8, w->size);
+    for(i = 0; i < blocks; i++) {
+        uint32_t n = bytes - i * EGDB_BLOCK < EGDB_BLOCK ? bytes - i * EGDB_BLOCK : EGDB_BLOCK;
+
+        put32(file + EGDB_HEADER + 4 * i, length);
+        length += compress(data + i * EGDB_BLOCK, n, file + head + length);
+    }
+    put32(file + EGDB_HEADER + 4 * blocks, length);
+
+    egdbname(name, dir, w->pieces);
+    if((out = fopen(name, "wb")) == NULL ||
+       fwrite(file, 1, head + length, out) != head + length ||
+       fclose(out) != 0) {
+        fprintf(stderr, "egdbgen: can't write %s\n", name);
+        exit(1);
+    }
+    packedbytes += bytes;
+    filebytes += head + length;
+    free(file);
+    return(data);
+}
+
+/* unpacks the table of a signature in dir, NULL if it is not there */
+static const uint8_t *load(const uint8_t pieces[4], const char *dir) {
+    const uint8_t *file;
+    uint8_t *data = NULL;
+    uint32_t length, size, bytes, blocks, i;
+    char name[512];
+
+    egdbname(name, dir, pieces);
+    if((file = tableopen(name, &length)) == NULL) {
+        return(NULL);
+    }
+    if(length < EGDB_HEADER || (size = egdbheader(file, pieces)) == 0) {
+        tableclose(file, length);
+        return(NULL);
+    }
+    bytes = egdbbytes(size);
+    blocks = (bytes + EGDB_BLOCK - 1) / EGDB_BLOCK;
+    if(length < EGDB_HEADER + 4 * (blocks + 1) || (data = malloc(bytes)) == NULL) {
+        tableclose(file, length);
+        return(NULL);
+    }
+    for(i = 0; i < blocks; i++) {
+        const uint8_t *offsets = file + EGDB_HEADER + 4 * i;
+        uint32_t start = egdbread32(offsets), end = egdbread32(offsets + 4);
+        uint32_t n = bytes - i * EGDB_BLOCK < EGDB_BLOCK ? bytes - i * EGDB_BLOCK : EGDB_BLOCK;
+
+        if(end < start || EGDB_HEADER + 4 * (blocks + 1) + end > length ||
+           egdbunpack(file + EGDB_HEADER + 4 * (blocks + 1) + start, end - start, data + i * EGDB_BLOCK, n) != n) {
+            tableclose(file, length);
+            free(data);
+            return(NULL);
+        }
+    }
+    packedbytes += bytes;
+    filebytes += length;
+    tableclose(file, length);
+    return(data);
+}
+
+/* solves a slice and its turned around partner together */
+static void solvepair(const uint8_t pieces[4], int threads, const char *dir) {
+    pthread_t thread[256];
+    uint32_t wins = 0, losses = 0, draws = 0;
+    double start = seconds();
+    int i, t;
+
+    pairs = 1;
+    memcpy(pair[0].pieces, pieces, 4);
+    pair[1].pieces[0] = pieces[2];
+    pair[1].pieces[1] = pieces[3];
+    pair[1].pieces[2] = pieces[0];
+    pair[1].pieces[3] = pieces[1];
+    if(memcmp(pair[0].pieces, pair[1].pieces, 4) != 0) {
+        pairs = 2;
+    }
+    for(i = 0; i < pairs; i++) {
+        pair[i].size = egdbsize(pair[i].pieces);
+        if((pair[i].values = malloc(pair[i].size)) == NULL) {
+            fprintf(stderr, "egdbgen: out of memory\n");
+            exit(1);
+        }
+        memset(pair[i].values, UNKNOWN, pair[i].size);
+    }
+
+    passes = 0;
+    do {
+        nextchunk = 0;
+        changed = 0;
+        for(t = 0; t < threads; t++) {
+            pthread_create(&thread[t], NULL, pass, NULL);
+        }
+        for(t = 0; t < threads; t++) {
+            pthread_join(thread[t], NULL);
+        }
+        passes++;
+    } while(changed != 0);
+
+    for(i = 0; i < pairs; i++) {
+        struct work *w = &pair[i];
+        uint32_t j;
+
+        for(j = 0; j < w->size; j++) {
+            struct egdbposition pos;
+
+            w->values[j] &= 3;
+            if(w->values[j] == UNKNOWN) {
+                w->values[j] = DRAW;
+            }
+            if(position(&pos, w->pieces, j)) {
+                wins += w->values[j] == WIN;
+                losses += w->values[j] == LOSS;
+                draws += w->values[j] == DRAW;
+            }
+        }
+        tables[w->pieces[0]][w->pieces[1]][w->pieces[2]][w->pieces[3]] = store(w, dir);
+        free(w->values);
+    }
+    printf("egdbgen E%d%d%d%d%s positions %lu wins %lu losses %lu draws %lu passes %d time %.2f\n",
+           pieces[0], pieces[1], pieces[2], pieces[3], pairs > 1 ? " and partner" : "",
+           (unsigned long)(wins + losses + draws), (unsigned long)wins, (unsigned long)losses,
+           (unsigned long)draws, passes, seconds() - start);
+    fflush(stdout);
+    pairs = 0;
+}
+
+int main(int argc, char **argv) {
+    int maxpieces = argc > 1 ? atoi(argv[1]) : 4;
+    int threads = argc > 2 ? atoi(argv[2]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *dir = argc > 3 ? argv[3] : ".";
+    double start = seconds();
+    uint8_t pieces[4];
+    int n, men;
+
+    if(maxpieces < 2 || maxpieces > EGDB_MAXPIECES) {
+        fprintf(stderr, "egdbgen: 2 to %d pieces\n", EGDB_MAXPIECES);
+        return 1;
+    }
+    if(threads < 1 || threads > 256) {
+        threads = 1;
+    }
+    egdbinit();
+    initsquares();
+
+    for(n = 2; n <= maxpieces; n++) {
+        for(men = 0; men <= n; men++) {
+            for(pieces[0] = 0; pieces[0] <= men; pieces[0]++) {
+                for(pieces[1] = 0; pieces[1] <= n - men; pieces[1]++) {
+                    uint8_t partner[4];
+                    const uint8_t *table, *other;
+
+                    pieces[2] = men - pieces[0];
+                    pieces[3] = n - men - pieces[1];
+                    partner[0] = pieces[2];
+                    partner[1] = pieces[3];
+                    partner[2] = pieces[0];
+                    partner[3] = pieces[1];
+                    if(pieces[0] + pieces[1] == 0 || pieces[2] + pieces[3] == 0 || memcmp(pieces, partner, 4) > 0) {
+                        continue;
+                    }
+                    table = load(pieces, dir);
+                    other = load(partner, dir);
+                    if(table != NULL && other != NULL) {
+                        tables[pieces[0]][pieces[1]][pieces[2]][pieces[3]] = table;
+                        tables[partner[0]][partner[1]][partner[2]][partner[3]] = other;
+                        printf("egdbgen E%d%d%d%d loaded\n", pieces[0], pieces[1], pieces[2], pieces[3]);
+                        continue;
+                    }
+                    free((void *)table);
+                    free((void *)other);
+                    solvepair(pieces, threads, dir);
+                }
+            }
+        }
+    }
+    printf("egdbgen pieces %d threads %d time %.2f packed %lu files %lu\n", maxpieces, threads,
+           seconds() - start, packedbytes, filebytes);
+    return 0;
+}
@@ -0,0 +1,105 @@
+/**
+ * endgame table probe benchmark for host builds of the engine
+ *
+ *   make -C tools && tools/egdbprobe dir [cachebytes [depth]]
+ *
+ * loads the tables in dir (see egdbgen.c) and probes them with a cache
+ * of cachebytes of unpacked blocks (default all EGDB_CACHEBLOCKS):
+ * first at uniformly random positions, the worst case for the cache,
+ * then through searches of endgame positions to depth (default 12).
+ * prints the probes, the share of them that found their block in the
+ * cache and the time per probe. the engine source is included directly
+ * to reach the probe internals.
+ */
+
+#include "simplech.c"
+
+#define RANDOMPROBES 1000000
+
+/* boards as in bench.c */
+static const struct {
+    const char *board;
+    uint8_t color;
+} positions[] = {
+    { "----B-------w-w-----w-w---------", BLACK },
+    { "---------W--b-b-----b-b---b-----", WHITE },
+    { "B-----w-w---w-w-----w-------W---", BLACK },
+    { "B---B-----------------W-----W---", BLACK },
+    { "--------b-----w------W-----B----", WHITE },
+    { "-------b--b----------w---W------", BLACK },
+};
+
+static uint32_t state = 2463534242u;
+
+static uint32_t xorshift(void) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return(state);
+}
+
+static void report(const char *name, uint32_t time) {
+    printf("egdbprobe %s probes %lu hits %lu hitrate %lu time %lu", name,
+           (unsigned long)egdbprobes, (unsigned long)(egdbprobes - egdbmisses),
+           (unsigned long)(egdbprobes ? (egdbprobes - egdbmisses) * 100 / egdbprobes : 0),
+           (unsigned long)time);
+}
+
+int main(int argc, char **argv) {
+    uint32_t cachebytes = argc > 2 ? (uint32_t)atol(argv[2]) : (uint32_t)EGDB_CACHEBLOCKS * EGDB_BLOCK;
+    uint32_t start, time = 0;
+    unsigned i;
+    long n;
+
+    if(argc < 2) {
+        fprintf(stderr, "usage: egdbprobe dir [cachebytes [depth]]\n");
+        return 1;
+    }
+    printf("egdbprobe tables %d cache %lu blocks\n", egdbload(argv[1], EGDB_MAXPIECES),
+           (unsigned long)(cachebytes / EGDB_BLOCK));
+    if(egdbcount == 0) {
+        return 1;
+    }
+    searchdepth = argc > 3 ? atoi(argv[3]) : 12;
+
+    egdbcache(cachebytes);
+    start = monotonicms();
+    for(n = 0; n < RANDOMPROBES; n++) {
+        struct egdbslice *slice = &egdbslices[xorshift() % egdbcount];
+
+        egdbprobeindex(slice, xorshift() % slice->size);
+    }
+    time = monotonicms() - start;
+    report("random", time);
+    printf(" ns/probe %lu\n", (unsigned long)((uint64_t)time * 1000000 / RANDOMPROBES));
+    time = 0;
+
+    egdbcache(cachebytes);
+    for(i = 0; i < sizeof(positions) / sizeof(positions[0]); i++) {
+        uint8_t b[8][8];
+        gamemove_t move;
+        int playnow = 0;
+        int j;
+
+        memset(b, 0, 64);
+        for(j = 0; j < 32; j++) {
+            uint8_t piece;
+            switch(positions[i].board[j]) {
+            case 'b': piece = BLACK | MAN; break;
+            case 'w': piece = WHITE | MAN; break;
+            case 'B': piece = BLACK | KING; break;
+            case 'W': piece = WHITE | KING; break;
+            default:  piece = FREE; break;
+            }
+            b[SQ_COL(j)][SQ_ROW(j)] = piece;
+        }
+        setgamehistory(b, positions[i].color, NULL, 0);
+        start = monotonicms();
+        getmove(b, positions[i].color, &playnow, &move);
+        time += monotonicms() - start;
+    }
+    /* the search time is all of it, not just the probes */
+    report("search", time);
+    printf(" depth %d\n", searchdepth);
+    return 0;
+}
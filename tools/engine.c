@@ -0,0 +1,486 @@
+/**
+ * line based engine protocol for host builds of the engine
+ *
+ *   make -C tools engine && tools/engine
+ *
+ * reads commands from stdin, one per line, and answers on stdout, so
+ * match managers and GUIs can run the engine as a child process:
+ *
+ *   hello                        id name ..., then ready
+ *   isready                      readyok, also while searching
+ *   newgame                      forgets what earlier games taught the search
+ *   level n                      plays at difficulty level n (0 easiest), or
+ *                                at full strength again with level none
+ *   egdb dir                     probes the endgame tables in dir
+ *   book file                    plays the moves of the opening book file,
+ *                                built by tools/bookgen, without a search
+ *   position start [moves ...]
+ *   position board b c [moves ...]
+ *                                sets up the starting position or board b, the
+ *                                32 playable squares in SQ_INDEX order as in
+ *                                bench.c with c, b or w, to move, and plays the
+ *                                moves, e.g. 11-15 or 15x24, in order
+ *   go [depth n] [nodes n] [movetime ms] [btime ms] [wtime ms] [binc ms]
+ *      [winc ms] [infinite] [ponder]
+ *                                searches until a limit is reached, until stop,
+ *                                or until the level's node budget is spent.
+ *                                without any limit it searches to the engine's
+ *                                nominal depth
+ *   stop                         ends the search, which answers with bestmove
+ *   ponderhit                    the pondered move was played, the limits of
+ *                                go start to count now
+ *   quit
+ *
+ * the search runs on a worker thread while the main thread keeps reading
+ * commands. after every completed depth it prints
+ *
+ *   info depth d seldepth s score v nodes n time ms nps n pv 11-15 23-19
+ *
+ * with the score from the side to move's point of view, and when it is
+ * done
+ *
+ *   bestmove 11-15 [ponder 23-19]
+ *
+ * or bestmove none without a legal move. an infinite or pondering search
+ * only answers once it is told to stop. "stop" and "ponderhit" only post
+ * flags; the search takes them itself every 256 nodes through the
+ * engine's searchpoll, so they take effect at once and no other thread
+ * writes its state. the engine source is included directly to drive its
+ * iterative deepening from here.
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "simplech.c"
+
+#define MAXLINE 4096
+#define MAXGAME 1024
+
+/* the position set up with "position" and the moves that led to it */
+static uint8_t board[8][8];
+static uint8_t tomove = BLACK;
+static gamemove_t game[MAXGAME];
+static uint16_t gamelength;
+
+/* limits of the search, 0 for none */
+struct limits {
+    int depth;
+    uint32_t nodes;
+    uint32_t movetime;  /* since startclock() */
+};
+
+static struct limits limits;
+static struct limits ponderlimits; /* the limits of go ponder, for ponderhit */
+static int leveled;     /* go without limits spends the level's node budget */
+static pthread_t worker;
+static int searching;
+static int stopflag;    /* stop, for pollsearch() */
+static int ponderhitflag; /* new limits in limits, for pollsearch() */
+static int waiting;     /* infinite or pondering, bestmove waits for stop */
+static int depthnow;    /* depth the worker is searching */
+static int playnow;     /* the engine's playnow, never set */
+
+static void startboard(uint8_t b[8][8]) {
+    int i;
+
+    memset(b, 0, 64);
+    for(i = 0; i < 32; i++) {
+        b[SQ_COL(i)][SQ_ROW(i)] = i < 12 ? (BLACK | MAN) : i >= 20 ? (WHITE | MAN) : FREE;
+    }
+}
+
+/* board from the 32 characters of str, 0 if they are not a board */
+static int setboard(uint8_t b[8][8], const char *str) {
+    int i;
+
+    if(strlen(str) != 32) {
+        return(0);
+    }
+    memset(b, 0, 64);
+    for(i = 0; i < 32; i++) {
+        uint8_t piece;
+        switch(str[i]) {
+        case 'b': piece = BLACK | MAN; break;
+        case 'w': piece = WHITE | MAN; break;
+        case 'B': piece = BLACK | KING; break;
+        case 'W': piece = WHITE | KING; break;
+        case '-': piece = FREE; break;
+        default: return(0);
+        }
+        b[SQ_COL(i)][SQ_ROW(i)] = piece;
+    }
+    return(1);
+}
+
+/* the legal moves of color on b, through the engine's generator */
+static int legalmoves(uint8_t b[8][8], uint8_t color, struct move2 movelist[MAXMOVES]) {
+    int n;
+
+    setupboard(b, color);
+    n = generatecapturelist(movelist, color);
+    if(n == 0) {
+        n = generatemovelist(movelist, color);
+    }
+    return(n);
+}
+
+/**
+ * plays the move written as from-to or from x to on the position, the
+ * first of several captures between the same squares. returns 0 for a
+ * move that is not legal
+ */
+static int playmove(const char *str) {
+    struct move2 movelist[MAXMOVES];
+    int from, to, n, i;
+    char sep;
+
+    if(sscanf(str, "%d%c%d", &from, &sep, &to) != 3 || (sep != '-' && sep != 'x') ||
+       gamelength == MAXGAME) {
+        return(0);
+    }
+    /* a multi-jump may list the squares it passes, the last one is where it ends */
+    if((str = strrchr(str, sep)) != NULL) {
+        to = atoi(str + 1);
+    }
+    n = legalmoves(board, tomove, movelist);
+    for(i = 0; i < n; i++) {
+        if(squarenumber(movelist[i].m[0] % 256) == from && squarenumber(movelist[i].m[1] % 256) == to) {
+            packmove(&movelist[i], &game[gamelength]);
+            makegamemove(board, &game[gamelength++]);
+            tomove ^= CHANGECOLOR;
+            return(1);
+        }
+    }
+    return(0);
+}
+
+static void info(int depth, int score) {
+    char pv[MAXPV * 6 + 1];
+    char *str = pv;
+    uint32_t time = readclock();
+    int i;
+
+    *str = 0;
+    for(i = 0; i < searchstats.pvlength; i++) {
+        if(i) {
+            *str++ = ' ';
+        }
+        pvtonotation(i, str);
+        str += strlen(str);
+    }
+    printf("info depth %d seldepth %d score %d nodes %lu time %lu nps %lu pv %s\n",
+           depth, searchstats.seldepth, tomove == BLACK ? score : -score,
+           (unsigned long)searchstats.nodes, (unsigned long)time,
+           (unsigned long)(time ? (uint64_t)searchstats.nodes * 1000 / time : 0), pv);
+    fflush(stdout);
+}
+
+/**
+ * the engine's searchpoll, on the worker every 256 nodes. the main thread
+ * only posts stop and the limits of ponderhit, the search's own state is
+ * changed here, by the thread that runs it
+ */
+static void pollsearch(void) {
+    if(__atomic_load_n(&stopflag, __ATOMIC_ACQUIRE)) {
+        stopsearch = 1;
+    }
+    if(__atomic_exchange_n(&ponderhitflag, 0, __ATOMIC_ACQ_REL)) {
+        uint32_t movetime = __atomic_load_n(&limits.movetime, __ATOMIC_ACQUIRE);
+        uint32_t nodes = __atomic_load_n(&limits.nodes, __ATOMIC_ACQUIRE);
+
+        /* the first depth always completes, as below */
+        if(movetime != 0 && __atomic_load_n(&depthnow, __ATOMIC_ACQUIRE) > 1) {
+            timelimit = movetime;
+        }
+        if(nodes != 0) {
+            nodecount = 0;
+            nodelimit = nodes;
+        }
+    }
+}
+
+/**
+ * iterative deepening of the position to the limits, the last completed
+ * depth decides. the main thread only changes the limits at ponderhit;
+ * pollsearch() takes them at once, and the search reads them again at
+ * every depth
+ */
+static void *search(void *unused) {
+    struct move2 movelist[MAXMOVES];
+    struct move2 best, played;
+    char str[16];
+    int depth, n;
+    int ponder = 0;
+
+    (void)unused;
+    memset(&searchstats, 0, sizeof(searchstats_t));
+    setgamehistory(board, tomove, game, gamelength);
+    n = legalmoves(board, tomove, movelist);
+#if BOOK
+    /* an infinite search is an analysis, which the book would cut short */
+    if(n != 0 && bookentries != 0 && !__atomic_load_n(&waiting, __ATOMIC_ACQUIRE) &&
+       bookmove(movelist, n, &played)) {
+        printf("info string book\n");
+    } else
+#endif
+    if(n != 0) {
+        played = best = movelist[0];
+        play = &playnow;
+        searchpoll = pollsearch;
+        ply = 0;
+        memset(killers, 0, sizeof(killers));
+        stopsearch = 0;
+        nodecount = 0;
+        for(depth = 1; depth <= MAXANALYSIS; depth++) {
+            int limit = __atomic_load_n(&limits.depth, __ATOMIC_ACQUIRE);
+            int value;
+
+            if(limit != 0 && depth > limit) {
+                break;
+            }
+            __atomic_store_n(&depthnow, depth, __ATOMIC_RELEASE);
+            /* the first depth always completes when there is a clock */
+            timelimit = depth > 1 ? __atomic_load_n(&limits.movetime, __ATOMIC_ACQUIRE) : 0;
+            nodelimit = __atomic_load_n(&limits.nodes, __ATOMIC_ACQUIRE);
+            arenatop = 0;
+            value = firstalphabeta(depth, -10000, 10000, tomove, &best);
+            if(stopsearch || *play) {
+                break;
+            }
+            played = best;
+            savepv();
+            info(depth, value);
+            /* nothing to think about */
+            if(n == 1 && !__atomic_load_n(&waiting, __ATOMIC_ACQUIRE)) {
+                break;
+            }
+        }
+        timelimit = 0;
+        nodelimit = 0;
+        ponder = searchstats.pvlength > 1;
+    }
+
+    /* an infinite search holds its answer until it is told to stop */
+    while(__atomic_load_n(&waiting, __ATOMIC_ACQUIRE) && !__atomic_load_n(&stopflag, __ATOMIC_ACQUIRE)) {
+        usleep(1000);
+    }
+    if(n == 0) {
+        printf("bestmove none\n");
+    } else {
+        movetonotation(played, str);
+        printf("bestmove %s", str);
+        /* the pv of the last completed depth starts with the move played */
+        if(ponder) {
+            pvtonotation(1, str);
+            printf(" ponder %s", str);
+        }
+        printf("\n");
+    }
+    fflush(stdout);
+    return(NULL);
+}
+
+/* stops the search, if there is one, and waits for its bestmove */
+static void stop(void) {
+    if(!searching) {
+        return;
+    }
+    __atomic_store_n(&stopflag, 1, __ATOMIC_RELEASE);
+    pthread_join(worker, NULL);
+    searching = 0;
+}
+
+/* the time of the side to move, spread over the moves still to come */
+static uint32_t budget(uint32_t time, uint32_t increment) {
+    uint32_t ms = time / 30 + increment;
+
+    if(ms > time / 2) {
+        ms = time / 2;
+    }
+    return(ms > 0 ? ms : 1);
+}
+
+static void go(char *args) {
+    uint32_t clock[2] = {0, 0}, increment[2] = {0, 0};
+    int infinite = 0, ponder = 0;
+    char *word;
+
+    memset(&limits, 0, sizeof(limits));
+    for(word = strtok(args, " \t"); word != NULL; word = strtok(NULL, " \t")) {
+        char *arg;
+
+        if(strcmp(word, "infinite") == 0) {
+            infinite = 1;
+        } else if(strcmp(word, "ponder") == 0) {
+            ponder = 1;
+        } else if((arg = strtok(NULL, " \t")) == NULL) {
+            break;
+        } else if(strcmp(word, "depth") == 0) {
+            limits.depth = atoi(arg);
+        } else if(strcmp(word, "nodes") == 0) {
+            limits.nodes = strtoul(arg, NULL, 10);
+        } else if(strcmp(word, "movetime") == 0) {
+            limits.movetime = strtoul(arg, NULL, 10);
+        } else if(strcmp(word, "btime") == 0) {
+            clock[0] = strtoul(arg, NULL, 10);
+        } else if(strcmp(word, "wtime") == 0) {
+            clock[1] = strtoul(arg, NULL, 10);
+        } else if(strcmp(word, "binc") == 0) {
+            increment[0] = strtoul(arg, NULL, 10);
+        } else if(strcmp(word, "winc") == 0) {
+            increment[1] = strtoul(arg, NULL, 10);
+        }
+    }
+    if(limits.movetime == 0 && clock[tomove == WHITE] != 0) {
+        limits.movetime = budget(clock[tomove == WHITE], increment[tomove == WHITE]);
+    }
+    if(infinite) {
+        memset(&limits, 0, sizeof(limits));
+    } else if(limits.depth == 0 && limits.nodes == 0 && limits.movetime == 0) {
+        if(leveled) {
+            limits.nodes = nodebudget;
+        } else {
+            limits.depth = searchdepth;
+        }
+    }
+
+    /* a pondering search runs without limits until ponderhit sets them */
+    if(ponder) {
+        ponderlimits = limits;
+        memset(&limits, 0, sizeof(limits));
+    }
+    waiting = infinite || ponder;
+    stopflag = 0;
+    ponderhitflag = 0;
+    startclock();
+    searching = pthread_create(&worker, NULL, search, NULL) == 0;
+}
+
+/* the opponent played the pondered move, the search goes on with the limits of go */
+static void ponderhit(void) {
+    struct limits hit = ponderlimits;
+
+    if(!searching || !__atomic_load_n(&waiting, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    memset(&ponderlimits, 0, sizeof(ponderlimits));
+    /* the clock of the move starts now, the search has been running all along */
+    if(hit.movetime != 0) {
+        hit.movetime += readclock();
+    }
+    /* the worker takes them in pollsearch() */
+    __atomic_store_n(&limits.movetime, hit.movetime, __ATOMIC_RELEASE);
+    __atomic_store_n(&limits.nodes, hit.nodes, __ATOMIC_RELEASE);
+    __atomic_store_n(&limits.depth, hit.depth, __ATOMIC_RELEASE);
+    __atomic_store_n(&ponderhitflag, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&waiting, 0, __ATOMIC_RELEASE);
+    /* past the depth limit already, the completed depths decide */
+    if(hit.depth != 0 && __atomic_load_n(&depthnow, __ATOMIC_ACQUIRE) > hit.depth) {
+        __atomic_store_n(&stopflag, 1, __ATOMIC_RELEASE);
+    }
+}
+
+static void position(char *args) {
+    uint8_t b[8][8];
+    uint8_t color = BLACK;
+    char *word = args != NULL ? strtok(args, " \t") : NULL;
+
+    if(word != NULL && strcmp(word, "start") == 0) {
+        startboard(b);
+    } else if(word != NULL && strcmp(word, "board") == 0) {
+        char *squares = strtok(NULL, " \t");
+        char *side = strtok(NULL, " \t");
+
+        if(squares == NULL || !setboard(b, squares) || side == NULL || (strcmp(side, "b") != 0 && strcmp(side, "w") != 0)) {
+            printf("info string bad board\n");
+            return;
+        }
+        color = side[0] == 'w' ? WHITE : BLACK;
+    } else {
+        printf("info string position start or board expected\n");
+        return;
+    }
+    memcpy(board, b, sizeof(board));
+    tomove = color;
+    gamelength = 0;
+    if((word = strtok(NULL, " \t")) == NULL || strcmp(word, "moves") != 0) {
+        return;
+    }
+    while((word = strtok(NULL, " \t")) != NULL) {
+        if(!playmove(word)) {
+            printf("info string illegal move %s\n", word);
+            return;
+        }
+    }
+}
+
+static void command(char *line) {
+    char *word = strtok(line, " \t\r\n");
+    char *rest = strtok(NULL, "\r\n");
+
+    if(word == NULL) {
+        return;
+    }
+    if(strcmp(word, "isready") == 0) {
+        printf("readyok\n");
+    } else if(strcmp(word, "stop") == 0) {
+        stop();
+    } else if(strcmp(word, "ponderhit") == 0) {
+        ponderhit();
+    } else if(strcmp(word, "quit") == 0) {
+        stop();
+        exit(0);
+    } else {
+        /* everything else changes the engine, which the search must not be using */
+        stop();
+        if(strcmp(word, "hello") == 0) {
+            printf("id name simple checkers\nid author Martin Fierz, Matt Waltz\nready\n");
+        } else if(strcmp(word, "newgame") == 0) {
+            searchreset();
+            startboard(board);
+            tomove = BLACK;
+            gamelength = 0;
+        } else if(strcmp(word, "level") == 0) {
+            char *end;
+            long level = rest != NULL ? strtol(rest, &end, 10) : -1;
+
+            if(rest != NULL && end != rest && level >= 0 && level < LEVELS) {
+                setlevel(level);
+                leveled = 1;
+            } else {
+                nodebudget = 0;
+                evalnoise = 0;
+                leveled = 0;
+            }
+#if EGDB
+        } else if(strcmp(word, "egdb") == 0) {
+            printf("info string egdb tables %d\n", rest != NULL ? egdbload(rest, EGDB_MAXPIECES) : 0);
+#endif
+#if BOOK
+        } else if(strcmp(word, "book") == 0) {
+            printf("info string book entries %lu\n", rest != NULL ? (unsigned long)bookload(rest) : 0UL);
+#endif
+        } else if(strcmp(word, "position") == 0) {
+            position(rest);
+        } else if(strcmp(word, "go") == 0) {
+            char none[1] = "";
+
+            go(rest != NULL ? rest : none);
+        } else {
+            printf("info string unknown command %s\n", word);
+        }
+    }
+    fflush(stdout);
+}
+
+int main(void) {
+    char line[MAXLINE];
+
+    startboard(board);
+    while(fgets(line, sizeof(line), stdin) != NULL) {
+        command(line);
+    }
+    stop();
+    return 0;
+}
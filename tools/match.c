@@ -0,0 +1,145 @@
+/**
+ * self play match for host builds of the engine
+ *
+ *   make -C tools && tools/match [lmrdepth [plaindepth]]
+ *   tools/match -l level level
+ *
+ * plays the engine with late move reductions against the engine without
+ * them, each searching to the given depth (default SEARCHDEPTH), or two
+ * difficulty levels against each other, both with the reductions. every
+ * two move opening is played twice, with colors swapped. a
+ * game ends when the side to move has no move, when it is drawn by
+ * repetition or the quiet move rule, or as a draw after MAXPLIES plies.
+ * the engine source is included directly to swap its tables between
+ * the moves of the two sides.
+ */
+
+#include "simplech.c"
+
+#define MAXPLIES 200
+
+/* the side that plays with the tuned reductions */
+#define TUNED 0
+
+static uint8_t tunedtable[LMRDEPTH][LMRMOVES];
+static int depths[2] = {SEARCHDEPTH, SEARCHDEPTH};
+static int playlevels[2] = {-1, -1}; /* -1 for a fixed depth */
+static gamemove_t moves[MAXPLIES];
+static unsigned long nodes[2];
+static uint32_t thinking[2];
+
+static void startboard(uint8_t b[8][8]) {
+    int i;
+
+    memset(b, 0, 64);
+    for(i = 0; i < 32; i++) {
+        b[SQ_COL(i)][SQ_ROW(i)] = i < 12 ? (BLACK | MAN) : i >= 20 ? (WHITE | MAN) : FREE;
+    }
+}
+
+/* the legal moves of color on b, through the engine's generator */
+static int legalmoves(uint8_t b[8][8], uint8_t color, struct move2 movelist[MAXMOVES]) {
+    int n;
+
+    hashboard(b, color);
+    for(n = 0; n < 46; n++) {
+        cboard[n] = OCCUPIED;
+    }
+    for(n = 0; n < 32; n++) {
+        uint8_t piece = b[SQ_COL(n)][SQ_ROW(n)];
+        cboard[n + 5 + (n + 4) / 8] = piece ? piece : FREE;
+    }
+    loadboard();
+    n = generatecapturelist(movelist, color);
+    if(n == 0) {
+        n = generatemovelist(movelist, color);
+    }
+    return(n);
+}
+
+/**
+ * plays one game from the opening given by two move indices, player
+ * TUNED has black if tunedblack is set. returns the score of player
+ * TUNED: 2 for a win, 1 for a draw, 0 for a loss
+ */
+static int playgame(int first, int second, int tunedblack) {
+    struct move2 movelist[MAXMOVES];
+    uint8_t b[8][8];
+    uint8_t color = BLACK;
+    int playnow = 0;
+    int plies, n;
+
+    startboard(b);
+    searchreset();
+    for(plies = 0; plies < 2; plies++) {
+        n = legalmoves(b, color, movelist);
+        packmove(&movelist[(plies ? second : first) % n], &moves[plies]);
+        makegamemove(b, &moves[plies]);
+        color ^= CHANGECOLOR;
+    }
+    for(; plies < MAXPLIES; plies++) {
+        int player = (color == BLACK) == (tunedblack != 0) ? TUNED : !TUNED;
+
+        if(setgamehistory(b, color, moves, plies) == DRAW) {
+            return(1);
+        }
+        if(player == TUNED || playlevels[player] >= 0) {
+            memcpy(lmrtable, tunedtable, sizeof(lmrtable));
+        } else {
+            memset(lmrtable, 0, sizeof(lmrtable));
+        }
+        searchdepth = depths[player];
+        if(playlevels[player] >= 0) {
+            setlevel(playlevels[player]);
+        } else {
+            nodebudget = 0;
+            evalnoise = 0;
+        }
+        if(!getmove(b, color, &playnow, &moves[plies])) {
+            return(player == TUNED ? 0 : 2);
+        }
+        nodes[player] += searchstats.nodes;
+        thinking[player] += searchstats.time;
+        color ^= CHANGECOLOR;
+    }
+    return(1);
+}
+
+int main(int argc, char **argv) {
+    int first, second, side;
+    int score[3] = {0, 0, 0};
+
+    if(argc > 3 && strcmp(argv[1], "-l") == 0) {
+        playlevels[TUNED] = atoi(argv[2]) % LEVELS;
+        playlevels[!TUNED] = atoi(argv[3]) % LEVELS;
+    } else {
+        if(argc > 1) {
+            depths[TUNED] = atoi(argv[1]);
+        }
+        if(argc > 2) {
+            depths[!TUNED] = atoi(argv[2]);
+        }
+    }
+
+    memcpy(tunedtable, lmrtable, sizeof(lmrtable));
+    /* seven moves for black, at most seven replies */
+    for(first = 0; first < 7; first++) {
+        for(second = 0; second < 7; second++) {
+            for(side = 0; side < 2; side++) {
+                score[playgame(first, second, side)]++;
+            }
+        }
+    }
+    if(playlevels[TUNED] >= 0) {
+        printf("match level %d against level %d\n", playlevels[TUNED], playlevels[!TUNED]);
+        printf("match level %d wins %d draws %d losses %d\n", playlevels[TUNED], score[2], score[1], score[0]);
+        printf("match nodes %lu against %lu time %lu against %lu\n", nodes[TUNED], nodes[!TUNED],
+               (unsigned long)thinking[TUNED], (unsigned long)thinking[!TUNED]);
+        return 0;
+    }
+    printf("match depth lmr %d plain %d\n", depths[TUNED], depths[!TUNED]);
+    printf("match lmr wins %d draws %d losses %d\n", score[2], score[1], score[0]);
+    printf("match nodes lmr %lu plain %lu time lmr %lu plain %lu\n", nodes[TUNED], nodes[!TUNED],
+           (unsigned long)thinking[TUNED], (unsigned long)thinking[!TUNED]);
+    return 0;
+}
@@ -0,0 +1,360 @@
+/**
+ * streaming reader of pdn (portable draughts notation) game archives for
+ * host tools, included after simplech.c
+ *
+ * pdnread() takes one game at a time from a file of any size through a
+ * fixed buffer, so memory stays the same for an archive of any length,
+ * and replays the moves with the engine's move generator: every game
+ * comes out as a start position, legal plies and a result.
+ *
+ * of the tags only FEN and Result are used. comments, variations,
+ * ; and % lines, move numbers, NAGs and move annotations are skipped. a
+ * move is from-to, from x to, or a capture with every square it lands
+ * on, 9x18x27, which tells apart captures between the same squares.
+ * results are 1-0, 0-1 and 1/2-1/2 from black's side, black starting on
+ * 1..12, the draughts forms 2-0, 0-2 and 1-1, or *. a game ends at its
+ * result, at the tags of the next game or at the end of the input.
+ *
+ * a game with a bad FEN tag, a move that can't be read or isn't legal,
+ * or more than PDN_MAXPLIES plies is marked with the error and keeps
+ * the plies before it.
+ */
+
+#ifndef PDN_H
+#define PDN_H
+
+#define PDN_MAXPLIES 1024
+#define PDN_BUFFER 65536
+#define PDN_TAGLENGTH 256
+/* squares a move lists, a king can land on at most 9 in a capture */
+#define PDN_MAXSQUARES 16
+
+/* why a game could not be read to its end */
+#define PDN_OK 0
+#define PDN_BADFEN 1
+#define PDN_BADMOVE 2
+#define PDN_ILLEGAL 3
+#define PDN_TOOLONG 4
+#define PDN_ERRORS 5
+
+const char *pdnerrors[PDN_ERRORS] = { "ok", "fen", "notation", "illegal", "length" };
+
+struct pdnreader {
+    FILE *in;
+    unsigned long line;     /* of the next character, from 1 */
+    unsigned long long bytes;
+    size_t pos, length;
+    unsigned char buffer[PDN_BUFFER];
+};
+
+struct pdngame {
+    uint8_t start[8][8];
+    uint8_t color;          /* to move in start */
+    uint8_t result;         /* WIN, LOSS or DRAW for black, or UNKNOWN */
+    uint8_t error;
+    uint16_t plies;
+    unsigned long line;     /* where the game starts */
+    unsigned long long offset; /* byte of its first tag or move */
+    gamemove_t moves[PDN_MAXPLIES];
+};
+
+void pdnopen(struct pdnreader *r, FILE *in) {
+    r->in = in;
+    r->line = 1;
+    r->bytes = 0;
+    r->pos = r->length = 0;
+}
+
+/* the next character without taking it, EOF at the end */
+static int pdnpeek(struct pdnreader *r) {
+    if(r->pos == r->length) {
+        r->length = fread(r->buffer, 1, PDN_BUFFER, r->in);
+        r->pos = 0;
+        if(r->length == 0) {
+            return(EOF);
+        }
+        r->bytes += r->length;
+    }
+    return(r->buffer[r->pos]);
+}
+
+/* bytes taken since pdnopen() */
+static unsigned long long pdntell(struct pdnreader *r) {
+    return(r->bytes - (r->length - r->pos));
+}
+
+static int pdnget(struct pdnreader *r) {
+    int c = pdnpeek(r);
+
+    if(c != EOF) {
+        r->pos++;
+        if(c == '\n') {
+            r->line++;
+        }
+    }
+    return(c);
+}
+
+/* skips up to and including the character end, (...) nest */
+static void pdnskip(struct pdnreader *r, int end) {
+    int depth = 1;
+    int c;
+
+    while((c = pdnget(r)) != EOF) {
+        if(end == ')' && c == '(') {
+            depth++;
+        } else if(c == end && --depth == 0) {
+            return;
+        } else if(end == ')' && c == '{') {
+            /* a comment in a variation may hold anything */
+            pdnskip(r, '}');
+        }
+    }
+}
+
+/* reads [name "value"], value at most PDN_TAGLENGTH - 1 characters */
+static void pdntag(struct pdnreader *r, char *name, char *value) {
+    size_t n = 0;
+    int c;
+
+    *name = *value = '\0';
+    pdnget(r);
+    while((c = pdnpeek(r)) == ' ' || c == '\t') {
+        pdnget(r);
+    }
+    while(((c = pdnpeek(r)) >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_') {
+        if(n < 31) {
+            name[n++] = c;
+        }
+        pdnget(r);
+    }
+    name[n] = '\0';
+    while((c = pdnpeek(r)) != EOF && c != '"' && c != ']' && c != '\n') {
+        pdnget(r);
+    }
+    n = 0;
+    if(c == '"') {
+        pdnget(r);
+        while((c = pdnget(r)) != EOF && c != '"' && c != '\n') {
+            if(c == '\\' && ((c = pdnget(r)) == EOF || c == '\n')) {
+                break;
+            }
+            if(n < PDN_TAGLENGTH - 1) {
+                value[n++] = c;
+            }
+        }
+    }
+    value[n] = '\0';
+    if(c != ']' && c != '\n') {
+        while((c = pdnget(r)) != EOF && c != ']' && c != '\n');
+    }
+}
+
+/* WIN, LOSS or DRAW for black of a result, UNKNOWN for *, 0-0 and others */
+static uint8_t pdnresult(const char *str) {
+    if(strcmp(str, "1-0") == 0 || strcmp(str, "2-0") == 0) {
+        return(WIN);
+    }
+    if(strcmp(str, "0-1") == 0 || strcmp(str, "0-2") == 0) {
+        return(LOSS);
+    }
+    if(strcmp(str, "1/2-1/2") == 0 || strcmp(str, "1-1") == 0) {
+        return(DRAW);
+    }
+    return(UNKNOWN);
+}
+
+static int pdnisresult(const char *str) {
+    return(strcmp(str, "1-0") == 0 || strcmp(str, "0-1") == 0 || strcmp(str, "1/2-1/2") == 0 ||
+           strcmp(str, "2-0") == 0 || strcmp(str, "0-2") == 0 || strcmp(str, "1-1") == 0 ||
+           strcmp(str, "0-0") == 0);
+}
+
+/**
+ * plays the move of str, squares in 1..32 notation joined by -, x or :,
+ * on b with color to move and appends it to the game. returns PDN_OK or
+ * the error
+ */
+static int pdnmove(struct pdngame *g, uint8_t b[8][8], uint8_t *color, const char *str) {
+    struct move2 movelist[MAXMOVES];
+    int squares[PDN_MAXSQUARES];
+    uint32_t captured = 0;
+    int count = 0, n, i;
+
+    for(;;) {
+        int square = 0, digits = 0;
+
+        while(*str >= '0' && *str <= '9' && digits < 3) {
+            square = square * 10 + *str++ - '0';
+            digits++;
+        }
+        if(digits == 0 || square < 1 || square > 32 || count == PDN_MAXSQUARES) {
+            return(PDN_BADMOVE);
+        }
+        squares[count++] = SQ_FROMNUMBER(square);
+        if(*str == '\0') {
+            break;
+        }
+        if(*str != '-' && *str != 'x' && *str != ':') {
+            return(PDN_BADMOVE);
+        }
+        str++;
+    }
+    if(count < 2) {
+        return(PDN_BADMOVE);
+    }
+    /* the squares a capture lands on give the pieces it takes */
+    if(count > 2) {
+        for(i = 1; i < count; i++) {
+            int from = squares[i - 1], to = squares[i];
+
+            if(abs(SQ_COL(from) - SQ_COL(to)) != 2 || abs(SQ_ROW(from) - SQ_ROW(to)) != 2) {
+                return(PDN_BADMOVE);
+            }
+            captured |= (uint32_t)1 << SQ_INDEX((SQ_COL(from) + SQ_COL(to)) / 2, (SQ_ROW(from) + SQ_ROW(to)) / 2);
+        }
+    }
+
+    setupboard(b, *color);
+    n = generatecapturelist(movelist, *color);
+    if(n == 0) {
+        n = generatemovelist(movelist, *color);
+    }
+    for(i = 0; i < n; i++) {
+        gamemove_t move;
+
+        packmove(&movelist[i], &move);
+        if(move.from != squares[0] || move.to != squares[count - 1] || (count > 2 && move.captured != captured)) {
+            continue;
+        }
+        if(g->plies == PDN_MAXPLIES) {
+            return(PDN_TOOLONG);
+        }
+        g->moves[g->plies++] = move;
+        makegamemove(b, &move);
+        *color ^= CHANGECOLOR;
+        return(PDN_OK);
+    }
+    return(PDN_ILLEGAL);
+}
+
+/**
+ * reads the next game. returns 0 at the end of the input
+ */
+int pdnread(struct pdnreader *r, struct pdngame *g) {
+    char name[32], token[PDN_TAGLENGTH];
+    uint8_t b[8][8];
+    uint8_t color = BLACK;
+    uint8_t tagresult = UNKNOWN;
+    int started = 0, movetext = 0, marked = 0;
+    int c, i;
+
+    memset(b, 0, sizeof(b));
+    for(i = 0; i < 32; i++) {
+        b[SQ_COL(i)][SQ_ROW(i)] = i < 12 ? (BLACK | MAN) : i >= 20 ? (WHITE | MAN) : FREE;
+    }
+    memcpy(g->start, b, sizeof(b));
+    g->color = BLACK;
+    g->result = UNKNOWN;
+    g->error = PDN_OK;
+    g->plies = 0;
+
+    while((c = pdnpeek(r)) != EOF) {
+        if(c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v') {
+            pdnget(r);
+            continue;
+        }
+        if(!started) {
+            started = 1;
+            g->line = r->line;
+            g->offset = pdntell(r);
+        }
+        /* comments before a game may belong to the one before */
+        if(!marked && c != '{' && c != '(' && c != ';' && c != '%') {
+            marked = 1;
+            g->offset = pdntell(r);
+        }
+        if(c == '[') {
+            /* the tags of the next game */
+            if(movetext) {
+                break;
+            }
+            pdntag(r, name, token);
+            if(strcmp(name, "FEN") == 0) {
+                if(fentoboard(token, b, &color)) {
+                    memcpy(g->start, b, sizeof(b));
+                    g->color = color;
+                } else {
+                    g->error = PDN_BADFEN;
+                }
+            } else if(strcmp(name, "Result") == 0) {
+                tagresult = pdnresult(token);
+            }
+        } else if(c == '{') {
+            pdnget(r);
+            pdnskip(r, '}');
+        } else if(c == '(') {
+            pdnget(r);
+            pdnskip(r, ')');
+        } else if(c == ';' || c == '%') {
+            pdnskip(r, '\n');
+        } else if(c == '*') {
+            pdnget(r);
+            g->result = UNKNOWN;
+            return(1);
+        } else if(c >= '0' && c <= '9') {
+            char *move = token;
+            size_t n = 0;
+
+            while(((c = pdnpeek(r)) >= '0' && c <= '9') || c == '-' || c == 'x' || c == ':' || c == '/' || c == '.') {
+                if(n < sizeof(token) - 1) {
+                    token[n++] = c;
+                }
+                pdnget(r);
+            }
+            token[n] = '\0';
+            movetext = 1;
+            if(pdnisresult(token)) {
+                g->result = pdnresult(token);
+                return(1);
+            }
+            /* a move number, maybe run into its move */
+            while(*move >= '0' && *move <= '9') {
+                move++;
+            }
+            if(*move == '.') {
+                while(*move == '.') {
+                    move++;
+                }
+            } else {
+                move = token;
+            }
+            if(*move != '\0' && g->error == PDN_OK) {
+                g->error = pdnmove(g, b, &color, move);
+            }
+        } else if(c == '$') {
+            /* a numeric annotation glyph */
+            pdnget(r);
+            while((c = pdnpeek(r)) >= '0' && c <= '9') {
+                pdnget(r);
+            }
+        } else if(c == '!' || c == '?' || c == '.') {
+            /* move annotations, and the ellipsis of a numbered white move */
+            pdnget(r);
+        } else {
+            /* a word that is not a move */
+            movetext = 1;
+            if(g->error == PDN_OK) {
+                g->error = PDN_BADMOVE;
+            }
+            while((c = pdnpeek(r)) != EOF && c != ' ' && c != '\t' && c != '\n' && c != '\r' &&
+                  c != '{' && c != '(' && c != '[') {
+                pdnget(r);
+            }
+        }
+    }
+    g->result = tagresult;
+    return(started);
+}
+
+#endif
@@ -0,0 +1,99 @@
+/**
+ * reads pdn game archives for host builds of the engine
+ *
+ *   make -C tools pdnscan && tools/pdnscan [-p] [file]
+ *
+ * streams the games of file, or stdin, through the reader of pdn.h and
+ * writes each game that replays without an error as one line
+ *
+ *   1-0 B:W21,...,32:B1,...,12 45 11-15 23-19 ... 9x18x27 ...
+ *
+ * the result from black's side, the start position in checkers fen, the
+ * number of plies and the plies. with -p it writes every position of
+ * those games instead, the start and the one after each ply, one fen per
+ * line, for tools/batch. games with an error and games without moves
+ * are left out; the count of games, plies, errors of each kind and the
+ * speed go to stderr at the end, with the line of the first game of each
+ * kind of error.
+ */
+
+#include "simplech.c"
+#include "pdn.h"
+
+static struct pdnreader reader;
+static struct pdngame game;
+
+static const char *results[4] = { "1/2-1/2", "1-0", "0-1", "*" };
+
+int main(int argc, char **argv) {
+    unsigned long games = 0, plies = 0, empty = 0;
+    unsigned long errors[PDN_ERRORS] = {0};
+    unsigned long firsterror[PDN_ERRORS] = {0};
+    int positions = 0;
+    FILE *in = stdin;
+    uint32_t start, time;
+    int i;
+
+    if(argc > 1 && strcmp(argv[1], "-p") == 0) {
+        positions = 1;
+        argc--;
+        argv++;
+    }
+    if(argc > 1 && (in = fopen(argv[1], "rb")) == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    start = monotonicms();
+    pdnopen(&reader, in);
+    while(pdnread(&reader, &game)) {
+        uint8_t b[8][8];
+        char str[FENLENGTH > MOVELENGTH ? FENLENGTH : MOVELENGTH];
+
+        if(game.error != PDN_OK) {
+            if(errors[game.error]++ == 0) {
+                firsterror[game.error] = game.line;
+            }
+            continue;
+        }
+        if(game.plies == 0) {
+            empty++;
+            continue;
+        }
+        games++;
+        plies += game.plies;
+        memcpy(b, game.start, sizeof(b));
+        boardtofen(b, game.color, str);
+        if(positions) {
+            uint8_t color = game.color;
+
+            puts(str);
+            for(i = 0; i < game.plies; i++) {
+                makegamemove(b, &game.moves[i]);
+                color ^= CHANGECOLOR;
+                boardtofen(b, color, str);
+                puts(str);
+            }
+            continue;
+        }
+        printf("%s %s %u", results[game.result], str, game.plies);
+        for(i = 0; i < game.plies; i++) {
+            gamemovetonotation(&game.moves[i], str);
+            printf(" %s", str);
+        }
+        printf("\n");
+    }
+    fflush(stdout);
+    time = monotonicms() - start;
+    fprintf(stderr, "pdnscan games %lu plies %lu empty %lu", games, plies, empty);
+    for(i = 1; i < PDN_ERRORS; i++) {
+        fprintf(stderr, " %s %lu", pdnerrors[i], errors[i]);
+    }
+    fprintf(stderr, " bytes %llu time %lu mb/s %lu\n", reader.bytes, (unsigned long)time,
+            (unsigned long)(time ? reader.bytes / 1000 / time : 0));
+    for(i = 1; i < PDN_ERRORS; i++) {
+        if(errors[i] != 0) {
+            fprintf(stderr, "pdnscan first %s error in the game from line %lu\n", pdnerrors[i], firsterror[i]);
+        }
+    }
+    return 0;
+}
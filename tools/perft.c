@@ -0,0 +1,89 @@
+/**
+ * move generator benchmark for host builds of the engine
+ *
+ *   make -C tools && tools/perft [depth]
+ *
+ * counts the leaf nodes of the full move tree of a fixed set of positions
+ * to the given depth (default 8) and times it. the engine source is
+ * included directly to reach its generator, domove and undomove. the
+ * counts must not depend on the board backend, see make compare.
+ */
+
+#include "simplech.c"
+
+/* boards list the 32 playable squares in SQ_INDEX order, as in bench.c */
+static const struct {
+    const char *board;
+    uint8_t color;
+} positions[] = {
+    { "bbbbbbbbbbbb--------wwwwwwwwwwww", BLACK },
+    { "bbbb-bbbbbbbw---b---wwww-www-www", BLACK },
+    { "b-bbbb-bbb-b-bb--w-ww--ww-w-ww-w", BLACK },
+    { "----B-------w-w-----w-w---------", BLACK },
+    { "B---B-----------------W-----W---", BLACK },
+    { "b-b-b---wwww------------b--W----", WHITE },
+    { "----www--w--www-----ww--BwB-----", BLACK },
+    { "---Bwww-----www-----www---------", BLACK },
+};
+
+static void setcboard(const char *str) {
+    int i;
+
+    for(i = 0; i < 46; i++) {
+        cboard[i] = OCCUPIED;
+    }
+    for(i = 0; i < 32; i++) {
+        uint8_t piece;
+        switch(str[i]) {
+        case 'b': piece = BLACK | MAN; break;
+        case 'w': piece = WHITE | MAN; break;
+        case 'B': piece = BLACK | KING; break;
+        case 'W': piece = WHITE | KING; break;
+        default:  piece = FREE; break;
+        }
+        cboard[i + 5 + (i + 4) / 8] = piece;
+    }
+    loadboard();
+}
+
+static unsigned long perft(int depth, uint8_t color) {
+    struct move2 movelist[MAXMOVES];
+    unsigned long nodes = 0;
+    int n, i;
+
+    n = generatecapturelist(movelist, color);
+    if(n == 0) {
+        n = generatemovelist(movelist, color);
+    }
+    if(depth == 1) {
+        return(n);
+    }
+    for(i = 0; i < n; i++) {
+        domove(movelist[i]);
+        nodes += perft(depth - 1, color ^ CHANGECOLOR);
+        undomove(movelist[i]);
+    }
+    return(nodes);
+}
+
+int main(int argc, char **argv) {
+    int depth = argc > 1 ? atoi(argv[1]) : 8;
+    unsigned long nodes, total = 0;
+    uint32_t start, time, totaltime = 0;
+    unsigned i;
+
+    printf("perft backend %s%s depth %d\n", BOARD_BITBOARD ? "bitboard" : "mailbox",
+           MOVEGEN_TABLES ? " tables" : "", depth);
+    for(i = 0; i < sizeof(positions) / sizeof(positions[0]); i++) {
+        setcboard(positions[i].board);
+        start = monotonicms();
+        nodes = perft(depth, positions[i].color);
+        time = monotonicms() - start;
+        total += nodes;
+        totaltime += time;
+        printf("perft position %u nodes %lu time %lu\n", i, nodes, (unsigned long)time);
+    }
+    printf("perft total nodes %lu time %lu nps %lu\n", total, (unsigned long)totaltime,
+           totaltime ? (unsigned long)(total * 1000.0 / totaltime) : 0);
+    return 0;
+}